@@ -0,0 +1,113 @@
+#ifndef BENCHUTIL_HPP
+#define BENCHUTIL_HPP
+
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+/**
+ * @brief run fn reps times and time the fastest run
+ *
+ * @return the fastest run in seconds
+ */
+template <typename Fn>
+inline double bestOf(int reps, Fn fn) {
+  double best = 1e30;
+  for (int i = 0; i < reps; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+    best = std::min(best, took.count());
+  }
+  return best;
+}
+
+/**
+ * @brief format a byte count with a K or M suffix, ex 256K
+ */
+inline std::string sizeLabel(size_t bytes) {
+  if (bytes >= (1 << 20) && bytes % (1 << 20) == 0) {
+    return std::to_string(bytes >> 20) + "M";
+  }
+  return std::to_string(bytes >> 10) + "K";
+}
+
+/**
+ * @brief a directory to benchmark on, either given or made for the run
+ *
+ * An argument that isn't a number names an existing directory. Otherwise
+ * a directory of that many empty files, or defaultEntries, is made under
+ * $TMPDIR or /tmp and removed again when the benchDir goes away.
+ */
+class benchDir {
+  private:
+    std::string _path;
+    bool        _made;
+
+  public:
+    benchDir(const std::string & arg, size_t defaultEntries) : _made(false) {
+      char *end;
+      size_t entries = strtoull(arg.c_str(), &end, 10);
+      if (!arg.empty() && *end != '\0') {
+        _path = arg;
+        return;
+      }
+      if (arg.empty()) {
+        entries = defaultEntries;
+      }
+
+      const char *tmp = getenv("TMPDIR");
+      std::string templ = std::string(tmp != NULL && *tmp ? tmp : "/tmp") + "/lspp-bench-XXXXXX";
+      if (mkdtemp(&templ[0]) == NULL) {
+        perror("mkdtemp: ");
+        exit(-1);
+      }
+      _path = templ;
+      _made = true;
+
+      int dirFd = open(_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      char name[32];
+      for (size_t i = 0; i < entries; ++i) {
+        snprintf(name, sizeof(name), "file%zu.dat", i);
+        int fd = openat(dirFd, name, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+          perror("openat: ");
+          exit(-1);
+        }
+        close(fd);
+      }
+      close(dirFd);
+    }
+
+    ~benchDir() {
+      if (!_made) {
+        return;
+      }
+      // Only the flat directory made above needs removing
+      DIR *dir = opendir(_path.c_str());
+      if (dir != NULL) {
+        struct dirent *dent;
+        while ((dent = readdir(dir)) != NULL) {
+          if (strcmp(dent->d_name, ".") && strcmp(dent->d_name, "..")) {
+            unlinkat(dirfd(dir), dent->d_name, 0);
+          }
+        }
+        closedir(dir);
+      }
+      rmdir(_path.c_str());
+    }
+
+    benchDir(const benchDir &) = delete;
+    benchDir & operator=(const benchDir &) = delete;
+
+    const std::string & path() const { return _path; }
+};
+
+#endif /* BENCHUTIL_HPP */
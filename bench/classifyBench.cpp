@@ -0,0 +1,159 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <regex>
+#include <random>
+#include <unordered_map>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../format.hpp"
+#include "../nameMatcher.hpp"
+#include "benchUtil.hpp"
+
+/**
+ * @brief time classifying a corpus of names into their formats
+ *
+ * Usage: classifyBench [NAMES]
+ *
+ * NAMES generated names (default 1000000), mostly with known extensions
+ * and some with unknown ones, none, exact table names or dotfile names,
+ * are classified as getFormatStyle() does for regular files: by whole name
+ * first, then by extension. The tables are searched by linear scans with
+ * a regex and extension cache, as before they were perfect hashed, and by
+ * the nameMatcher automaton and compile time extension hash. Both must
+ * pick the same format for every name.
+ */
+
+/**
+ * @brief split a name into its base and extension
+ */
+static void splitName(std::string_view name, std::string_view & base, std::string_view & ext) {
+  const size_t index = name.find_last_of('.');
+  if (index == std::string_view::npos || index == 0) {
+    base = name;
+    ext = "";
+  } else {
+    base = name.substr(0, index);
+    ext = name.substr(index + 1);
+  }
+}
+
+/**
+ * @brief the format of a name without an exact or pattern match
+ */
+static const fileFmt * byExtension(const fileFmt * found, std::string_view base) {
+  if (found != NULL) {
+    return found;
+  }
+  return !base.empty() && base[0] == '.' ? &generalFormat[dotfileIndex]
+                                         : &generalFormat[fileIndex];
+}
+
+/**
+ * @brief classify by scanning the tables, caching regexes and extensions
+ */
+static const fileFmt * classifyLinear(std::string_view name) {
+  static std::unordered_map<const fileNameFmt *, std::regex> regMap;
+  static std::unordered_map<std::string, const fileFmt *> extCache;
+
+  for (const fileNameFmt & entry : nameFormat) {
+    if (entry.match == exactName) {
+      if (name == entry.name) {
+        return &entry;
+      }
+      continue;
+    }
+    auto it = regMap.find(&entry);
+    if (it == regMap.end()) {
+      it = regMap.emplace(&entry, std::regex(std::string(entry.name))).first;
+    }
+    if (std::regex_match(name.begin(), name.end(), it->second)) {
+      return &entry;
+    }
+  }
+
+  std::string_view base, ext;
+  splitName(name, base, ext);
+  const std::string key(ext);
+  auto it = extCache.find(key);
+  if (it == extCache.end()) {
+    const fileFmt * found = NULL;
+    for (const fileFmt & entry : extFormat) {
+      if (ext == entry.name) {
+        found = &entry;
+        break;
+      }
+    }
+    it = extCache.emplace(key, found).first;
+  }
+  return byExtension(it->second, base);
+}
+
+/**
+ * @brief classify through the name automaton and the extension hash
+ */
+static const fileFmt * classifyHashed(std::string_view name) {
+  static const nameMatcher matcher(nameFormat, sizeof(nameFormat)/sizeof(*nameFormat));
+
+  const fileNameFmt * entry = matcher.match(name);
+  if (entry != NULL) {
+    return entry;
+  }
+  std::string_view base, ext;
+  splitName(name, base, ext);
+  return byExtension(extHash.find(ext), base);
+}
+
+/**
+ * @brief build a reproducible corpus of names
+ */
+static std::vector<std::string> makeCorpus(size_t n) {
+  std::mt19937 rng(1);
+  std::vector<std::string> names;
+  names.reserve(n);
+  const size_t nExt   = sizeof(extFormat) / sizeof(*extFormat);
+  const size_t nNames = sizeof(nameFormat) / sizeof(*nameFormat);
+  for (size_t i = 0; i < n; ++i) {
+    const std::string stem = "file" + std::to_string(i);
+    const unsigned kind = rng() % 100;
+    if (kind < 70) {
+      names.push_back(stem + "." + std::string(extFormat[1 + rng() % (nExt - 1)].name));
+    } else if (kind < 85) {
+      names.push_back(stem + ".x" + std::to_string(rng() % 500));
+    } else if (kind < 90) {
+      names.push_back(stem);
+    } else if (kind < 95) {
+      names.push_back(std::string(nameFormat[rng() % (nNames - 1)].name));
+    } else {
+      names.push_back("." + stem + (rng() % 2 ? "rc" : ""));
+    }
+  }
+  return names;
+}
+
+int main(int argc, char **argv) {
+  const size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+  const std::vector<std::string> names = makeCorpus(n);
+
+  std::vector<const fileFmt *> linear(n), hashed(n);
+  const double linearSecs = bestOf(3, [&] {
+                              for (size_t i = 0; i < n; ++i) linear[i] = classifyLinear(names[i]); });
+  const double hashedSecs = bestOf(3, [&] {
+                              for (size_t i = 0; i < n; ++i) hashed[i] = classifyHashed(names[i]); });
+
+  size_t mismatches = 0;
+  for (size_t i = 0; i < n; ++i) {
+    mismatches += linear[i] != hashed[i];
+  }
+
+  printf("%-16s %10s %10s %10s\n", "lookup", "names", "ms", "ns/name");
+  printf("%-16s %10zu %10.1f %10.1f\n", "linear+cache", n, linearSecs * 1e3, linearSecs * 1e9 / n);
+  printf("%-16s %10zu %10.1f %10.1f\n", "matcher+hash", n, hashedSecs * 1e3, hashedSecs * 1e9 / n);
+  if (mismatches != 0) {
+    fprintf(stderr, "classifyBench: %zu names classified differently\n", mismatches);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "../dirReader.hpp"
+#include "benchUtil.hpp"
+
+/**
+ * @brief compare getdents64 calls and read time of opendir/readdir against
+ *        dirReader at several buffer sizes
+ *
+ * Usage: dirBench [ENTRIES | DIR]
+ *
+ * Without a directory one holding ENTRIES empty files (default 200000) is
+ * made under $TMPDIR and removed afterwards. Times are the best of several
+ * warm runs, both columns are scaled to a million entries. readdir makes
+ * its getdents64 calls inside glibc, where they can't be counted, so only
+ * the readers' calls are shown.
+ */
+
+/**
+ * @brief read a directory with opendir/readdir
+ *
+ * @return the number of entries read
+ */
+static size_t readWithLibc(const std::string & path) {
+  DIR *dir = opendir(path.c_str());
+  if (dir == NULL) {
+    perror("opendir: ");
+    exit(-1);
+  }
+  size_t n = 0;
+  while (readdir(dir) != NULL) {
+    ++n;
+  }
+  closedir(dir);
+  return n;
+}
+
+/**
+ * @brief read a directory with a dirReader of bufSize bytes
+ *
+ * @param calls set to the number of getdents64 calls made
+ *
+ * @return the number of entries read
+ */
+static size_t readWithReader(const std::string & path, size_t bufSize, size_t & calls) {
+  int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  dirReader dir(bufSize);
+  if (fd < 0 || !dir.attach(fd)) {
+    perror("open: ");
+    exit(-1);
+  }
+  dirEntry dent;
+  size_t n = 0;
+  while (dir.next(dent)) {
+    ++n;
+  }
+  calls = dir.nCalls();
+  close(fd);
+  return n;
+}
+
+int main(int argc, char **argv) {
+  benchDir tree(argc > 1 ? argv[1] : "", 200000);
+  const std::string path = tree.path();
+
+  size_t entries = 0, calls = 0;
+  printf("%-16s %10s %12s %10s\n", "reader", "entries", "calls/M", "ms/M");
+
+  double secs = bestOf(5, [&] { entries = readWithLibc(path); });
+  printf("%-16s %10zu %12s %10.2f\n", "readdir", entries, "-",
+         secs * 1e9 / entries);
+
+  for (size_t bufSize : {32 << 10, 256 << 10, 1 << 20, 4 << 20}) {
+    secs = bestOf(5, [&] { entries = readWithReader(path, bufSize, calls); });
+    printf("dirReader %-6s %10zu %12.0f %10.2f\n", sizeLabel(bufSize).c_str(), entries,
+           calls * 1e6 / entries, secs * 1e9 / entries);
+  }
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../columnLayout.hpp"
+#include "benchUtil.hpp"
+
+/**
+ * @brief time laying out a listing in columns at several terminal widths
+ *
+ * Usage: layoutBench [NAMES]
+ *
+ * NAMES entries (default 1000000), 8 to 24 columns wide like generated
+ * spool names, are laid out by columnLayout and by the search printColumns
+ * used before it: doubling the row count until everything fits, then
+ * binary searching between the last two counts, rescanning every entry on
+ * each probe. The old search isn't guaranteed to find the fewest rows, so
+ * both row counts are printed.
+ */
+
+/**
+ * @brief check if the entries fit in rows rows, rescanning all of them
+ */
+static bool fitsInNRows(const std::vector<uint16_t> & widths, size_t lineWidth, size_t rows) {
+  size_t total = 0;
+  for (size_t first = 0; first < widths.size(); first += rows) {
+    const size_t last = std::min(first + rows, widths.size());
+    total += *std::max_element(widths.begin() + first, widths.begin() + last);
+  }
+  return total <= lineWidth;
+}
+
+/**
+ * @brief the old doubling and binary search for a row count
+ */
+static size_t searchRows(const std::vector<uint16_t> & widths, size_t lineWidth) {
+  // Capped at a single column, which the old search never stopped at
+  size_t rows = 1;
+  while (rows < widths.size() && !fitsInNRows(widths, lineWidth, rows)) {
+    rows *= 2;
+  }
+  size_t max = rows;
+  size_t min = std::max((size_t) 2, rows / 2);
+  while (max > min) {
+    size_t test = (max + min) / 2;
+    if (fitsInNRows(widths, lineWidth, test)) {
+      max = test;
+    } else {
+      min = test + 1;
+    }
+  }
+  return max;
+}
+
+int main(int argc, char **argv) {
+  const size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+  const size_t padding = 2;
+
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<uint16_t> length(8, 24);
+  std::vector<uint16_t> widths(n);
+  for (uint16_t & w : widths) {
+    w = length(rng) + padding;
+  }
+
+  printf("%-8s %10s %10s %10s %10s %10s\n", "columns", "names", "rows", "ms", "old rows", "old ms");
+  for (size_t lineWidth : {80, 200, 1000, 4000}) {
+    size_t rows = 0, oldRows = 0;
+    const double secs = bestOf(3, [&] {
+                          std::vector<uint16_t> copy(widths);
+                          columnLayout layout(std::move(copy));
+                          rows = layout.fit(lineWidth); });
+    const double oldSecs = bestOf(3, [&] { oldRows = searchRows(widths, lineWidth); });
+    printf("%-8zu %10zu %10zu %10.1f %10zu %10.1f\n", lineWidth, n, rows, secs * 1e3,
+           oldRows, oldSecs * 1e3);
+  }
+  return 0;
+}
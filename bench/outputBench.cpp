@@ -0,0 +1,105 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../format.hpp"
+#include "../outWriter.hpp"
+#include "benchUtil.hpp"
+
+/**
+ * @brief measure listing output throughput into a pipe in MB/s
+ *
+ * Usage: outputBench [LINES]
+ *
+ * LINES colored one-per-line entries (default 1000000) are written to a
+ * pipe drained by a child process, field by field through std::cout ending
+ * each line with std::endl as the printers used to, with '\n' instead, and
+ * through outWriter. Each run lasts until the reader has seen every byte.
+ */
+
+/**
+ * @brief run write with stdout sent into a pipe that a child drains
+ *
+ * @param write produces the output, on fd 1
+ *
+ * @return seconds until the child has read all of it
+ */
+static double timePiped(const std::function<void()> & write) {
+  int fds[2];
+  if (pipe(fds) < 0) {
+    perror("pipe: ");
+    exit(-1);
+  }
+  pid_t child = fork();
+  if (child == 0) {
+    close(fds[1]);
+    char buf[1 << 16];
+    while (read(fds[0], buf, sizeof(buf)) > 0) {
+    }
+    _exit(0);
+  }
+  close(fds[0]);
+
+  fflush(stdout);
+  int saved = dup(STDOUT_FILENO);
+  dup2(fds[1], STDOUT_FILENO);
+  close(fds[1]);
+
+  double secs = bestOf(1, [&] {
+                  write();
+                  std::cout.flush();
+                  dup2(saved, STDOUT_FILENO);
+                  waitpid(child, NULL, 0);
+                });
+  close(saved);
+  return secs;
+}
+
+int main(int argc, char **argv) {
+  const size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+  const std::string_view color = extFormat[1].fmt;
+  const std::string_view reset = ESC "0m";
+
+  std::vector<std::string> names(n);
+  size_t bytes = 0;
+  for (size_t i = 0; i < n; ++i) {
+    names[i] = "file" + std::to_string(i) + ".txt";
+    bytes += color.size() + names[i].size() + reset.size() + 1;
+  }
+
+  struct method {
+    const char            *name;
+    std::function<void()>  write;
+  };
+  const std::vector<method> methods = {
+    {"cout endl", [&] {
+       for (const std::string & name : names) {
+         std::cout << color << name << reset << std::endl;
+       }}},
+    {"cout \\n", [&] {
+       for (const std::string & name : names) {
+         std::cout << color << name << reset << '\n';
+       }}},
+    {"outWriter", [&] {
+       outWriter out;
+       for (const std::string & name : names) {
+         out.put(color);
+         out.put(name);
+         out.put(reset);
+         out.put('\n');
+       }}},
+  };
+
+  printf("%-12s %10s %10s %10s\n", "writer", "lines", "ms", "MB/s");
+  for (const method & m : methods) {
+    const double secs = timePiped(m.write);
+    printf("%-12s %10zu %10.1f %10.1f\n", m.name, n, secs * 1e3, bytes / secs / 1e6);
+  }
+  return 0;
+}
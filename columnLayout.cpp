@@ -0,0 +1,93 @@
+#include <algorithm>
+
+#include "columnLayout.hpp"
+
+/**
+ * @brief prepare to lay out entries of the given widths
+ *
+ * @param widths each entry's display width, including the gap after it
+ */
+columnLayout::columnLayout(std::vector<uint16_t> && widths) :
+  _widths(std::move(widths)),
+  _spanMax(_widths),
+  _level(0)
+  {}
+
+/**
+ * @brief double the span covered by each _spanMax entry
+ *
+ * Spans are cut off at the end of the list. Going upwards, the entry read
+ * for position i + half hasn't been widened yet, so this works in place.
+ */
+void columnLayout::raiseLevel() {
+  size_t half = (size_t) 1 << _level;
+  for (size_t i = 0; i + half < _spanMax.size(); ++i) {
+    _spanMax[i] = std::max(_spanMax[i], _spanMax[i + half]);
+  }
+  ++_level;
+}
+
+/**
+ * @brief width of the column starting at entry first
+ *
+ * @param rows the row count, at least 2^_level
+ */
+size_t columnLayout::colWidth(size_t first, size_t rows) const {
+  size_t span = (size_t) 1 << _level;
+  size_t len  = std::min(rows, _spanMax.size() - first);
+  if (len < span) {
+    // Only the last column is shorter, its span is cut off at its end
+    return _spanMax[first];
+  }
+  return std::max(_spanMax[first], _spanMax[first + len - span]);
+}
+
+/**
+ * @brief check if the entries fit on lines of lineWidth in rows rows
+ *
+ * Stops at the first column that doesn't fit
+ */
+bool columnLayout::fits(size_t rows, size_t lineWidth) {
+  while (((size_t) 2 << _level) <= rows) {
+    raiseLevel();
+  }
+  size_t total = 0;
+  for (size_t first = 0; first < _widths.size(); first += rows) {
+    total += colWidth(first, rows);
+    if (total > lineWidth) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief find the fewest rows that fit and the column widths they give
+ *
+ * @param lineWidth the terminal width
+ *
+ * @return the number of rows, a single column if nothing narrower fits
+ */
+size_t columnLayout::fit(size_t lineWidth) {
+  size_t n = _widths.size();
+  _colWidths.clear();
+  if (n == 0) {
+    return 1;
+  }
+
+  // No more columns than the narrowest entry fits on a line
+  size_t narrowest = std::max(*std::min_element(_widths.begin(), _widths.end()), (uint16_t) 1);
+  size_t maxCols = std::max((size_t) 1, lineWidth / narrowest);
+  size_t rows = (n + maxCols - 1) / maxCols;
+  while (rows < n && !fits(rows, lineWidth)) {
+    ++rows;
+  }
+  while (((size_t) 2 << _level) <= rows) {
+    raiseLevel();
+  }
+
+  for (size_t first = 0; first < n; first += rows) {
+    _colWidths.push_back(colWidth(first, rows));
+  }
+  return rows;
+}
@@ -0,0 +1,42 @@
+#ifndef COLUMNLAYOUT_HPP
+#define COLUMNLAYOUT_HPP
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief finds the fewest rows that fit a listing in columns on the terminal
+ *
+ * Entries fill the columns top to bottom, each column as wide as its widest
+ * entry. Row counts are tried upwards from the lower bound set by the
+ * narrowest entry, giving up on a count as soon as its columns overflow
+ * the line. The widest entry of a column is one lookup into a table of
+ * block maxima, which is widened in place each time the row count reaches
+ * the next power of two, so the whole search is O(n log n) in the worst
+ * case and two arrays of entry widths in memory.
+ */
+class columnLayout {
+  private:
+    std::vector<uint16_t> _widths;     // width of each entry, with padding
+    std::vector<uint16_t> _spanMax;    // max of _widths over [i, i + 2^_level)
+    unsigned              _level;
+    std::vector<size_t>   _colWidths;
+
+  private:
+    void   raiseLevel();
+    size_t colWidth(size_t first, size_t rows) const;
+    bool   fits(size_t rows, size_t lineWidth);
+
+  public:
+    columnLayout(std::vector<uint16_t> && widths);
+
+    size_t fit(size_t lineWidth);
+
+    /**
+     * @brief the width of each column of the last fit, padding included
+     */
+    const std::vector<size_t> & colWidths() const { return _colWidths; }
+};
+
+#endif /* COLUMNLAYOUT_HPP */
@@ -0,0 +1,184 @@
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "dirHandle.hpp"
+
+std::mutex             dirHandle::handlesLock;
+std::list<dirHandle *> dirHandle::openHandles;
+size_t                 dirHandle::nOpening = 0;
+std::condition_variable dirHandle::handleOpened;
+
+dirHandle::dirHandle(const std::shared_ptr<dirHandle> & parent, const std::string & name) :
+  _parent(parent),
+  _name(name),
+  _fd(-1),
+  _pins(0),
+  _opening(false)
+  {}
+
+dirHandle::~dirHandle() {
+  std::lock_guard<std::mutex> guard(handlesLock);
+  if (_fd >= 0) {
+    close(_fd);
+    openHandles.erase(_lru);
+  }
+}
+
+/**
+ * @brief create a handle for a directory given on the command line
+ *
+ * @param path path of the directory, relative to the working directory
+ *
+ * @return the handle, the directory is opened when first pinned
+ */
+std::shared_ptr<dirHandle> dirHandle::open(const std::string & path) {
+  return std::shared_ptr<dirHandle>(new dirHandle(NULL, path));
+}
+
+/**
+ * @brief create a handle for a subdirectory
+ *
+ * @param parent the directory containing it
+ * @param name the subdirectory's name
+ *
+ * @return the handle, the directory is opened relative to parent when pinned
+ */
+std::shared_ptr<dirHandle> dirHandle::child(const std::shared_ptr<dirHandle> & parent,
+                                            const std::string & name) {
+  return std::shared_ptr<dirHandle>(new dirHandle(parent, name));
+}
+
+/**
+ * @brief build the directory's path by walking up its parents
+ *
+ * @return the path as given on the command line followed by each name
+ */
+std::string dirHandle::getPath() const {
+  size_t len = 0;
+  for (const dirHandle *d = this; d != NULL; d = d->_parent.get()) {
+    len += d->_name.length() + 1;
+  }
+
+  std::string path(len - 1, '/');
+  for (const dirHandle *d = this; d != NULL; d = d->_parent.get()) {
+    len -= d->_name.length() + 1;
+    path.replace(len, d->_name.length(), d->_name);
+  }
+  return path;
+}
+
+/**
+ * @brief number of directory descriptors that may be open at once
+ *
+ * @return half of the soft open file limit, leaving room for everything else
+ */
+size_t dirHandle::budget() {
+  static size_t limit = 0;
+  if (limit == 0) {
+    struct rlimit rl;
+    limit = 16;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) {
+      limit = std::max(limit, (size_t) rl.rlim_cur / 2);
+    }
+    limit = std::min(limit, (size_t) 4096);
+  }
+  return limit;
+}
+
+/**
+ * @brief close least recently used descriptors until there is room for one
+ */
+void dirHandle::evict() {
+  auto it = openHandles.end();
+  while (openHandles.size() + nOpening >= budget() && it != openHandles.begin()) {
+    --it;
+    dirHandle *h = *it;
+    if (h->_pins == 0) {
+      close(h->_fd);
+      h->_fd = -1;
+      it = openHandles.erase(it);
+    }
+  }
+}
+
+/**
+ * @brief pin the handle with handlesLock held, opening it if needed
+ *
+ * The lock is let go while the directory, and any closed parents of it,
+ * are opened. Meanwhile the handle is marked as opening and other threads
+ * pinning it wait for the result rather than opening it again.
+ *
+ * @param lock holds handlesLock, and does again on return
+ *
+ * @return the directory's descriptor, or -1 with errno set
+ */
+int dirHandle::pinLocked(std::unique_lock<std::mutex> & lock) {
+  handleOpened.wait(lock, [this] { return !_opening; });
+  if (_fd >= 0) {
+    openHandles.splice(openHandles.begin(), openHandles, _lru);
+    ++_pins;
+    return _fd;
+  }
+
+  _opening = true;
+  int dirfd = AT_FDCWD;
+  if (_parent) {
+    dirfd = _parent->pinLocked(lock);
+    if (dirfd < 0) {
+      int err = errno;
+      _opening = false;
+      handleOpened.notify_all();
+      errno = err;
+      return -1;
+    }
+  }
+  evict();
+  ++nOpening;
+
+  lock.unlock();
+  int fd = openat(dirfd, _name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  int err = errno;
+  lock.lock();
+
+  --nOpening;
+  if (_parent) {
+    _parent->unpinLocked();
+  }
+  _opening = false;
+  handleOpened.notify_all();
+  if (fd < 0) {
+    errno = err;
+    return -1;
+  }
+  _fd = fd;
+  openHandles.push_front(this);
+  _lru = openHandles.begin();
+  ++_pins;
+  return _fd;
+}
+
+void dirHandle::unpinLocked() {
+  --_pins;
+}
+
+/**
+ * @brief get the directory's descriptor, keeping it open until unpin()
+ *
+ * @return the descriptor, or -1 with errno set if it couldn't be opened
+ */
+int dirHandle::pin() {
+  std::unique_lock<std::mutex> lock(handlesLock);
+  return pinLocked(lock);
+}
+
+/**
+ * @brief release a pin, letting the descriptor be closed if over budget
+ */
+void dirHandle::unpin() {
+  std::lock_guard<std::mutex> guard(handlesLock);
+  unpinLocked();
+}
@@ -0,0 +1,81 @@
+#ifndef DIRHANDLE_HPP
+#define DIRHANDLE_HPP
+
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * @brief an open directory that its entries are stat'd relative to
+ *
+ * Subdirectories are opened with openat on their parent's descriptor, so
+ * the kernel never re-resolves the full path and deep trees don't run into
+ * PATH_MAX. Only a budget of descriptors stays open at once: the least
+ * recently used unpinned one is closed when the budget is reached, and it
+ * is reopened through its parent the next time it is pinned. Only the name
+ * within the parent is kept, full paths are built on demand for display.
+ * The lock only covers the bookkeeping, directories are opened without it
+ * so threads reading different directories don't wait on each other.
+ */
+class dirHandle {
+  private:
+    std::shared_ptr<dirHandle> _parent; // NULL for the listed directory
+    std::string    _name;        // name in the parent, or path if no parent
+    int            _fd;          // -1 while closed
+    unsigned       _pins;        // users currently holding _fd
+    bool           _opening;     // a thread is opening it, others wait
+    std::list<dirHandle *>::iterator _lru; // position in openHandles
+
+  private:
+    // Guards descriptors, pin counts and the open list of every handle
+    static std::mutex             handlesLock;
+    // Open handles, most recently used first
+    static std::list<dirHandle *> openHandles;
+    // Descriptors being opened, counted against the budget
+    static size_t                 nOpening;
+    // Signals an open finished, successfully or not
+    static std::condition_variable handleOpened;
+
+  private:
+    dirHandle(const std::shared_ptr<dirHandle> & parent, const std::string & name);
+
+    int  pinLocked(std::unique_lock<std::mutex> & lock);
+    void unpinLocked();
+    static void evict();
+    static size_t budget();
+
+  public:
+    ~dirHandle();
+
+    static std::shared_ptr<dirHandle> open(const std::string & path);
+    static std::shared_ptr<dirHandle> child(const std::shared_ptr<dirHandle> & parent,
+                                            const std::string & name);
+
+    int  pin();
+    void unpin();
+
+    std::string getPath() const;
+
+    const std::shared_ptr<dirHandle> & getParent() const { return _parent; }
+    const std::string                & getName()   const { return _name; }
+
+    /**
+     * @brief keeps a handle's descriptor open for the guard's lifetime
+     */
+    class pinGuard {
+      private:
+        dirHandle & _dir;
+        int         _fd;
+      public:
+        pinGuard(dirHandle & dir) : _dir(dir), _fd(dir.pin()) {}
+        ~pinGuard() { if (_fd >= 0) _dir.unpin(); }
+        pinGuard(const pinGuard &) = delete;
+        pinGuard & operator=(const pinGuard &) = delete;
+
+        int fd() const { return _fd; }
+    };
+};
+
+#endif /* DIRHANDLE_HPP */
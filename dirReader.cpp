@@ -0,0 +1,99 @@
+#include <algorithm>
+
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "dirReader.hpp"
+
+// Record layout returned by the getdents64 syscall
+struct linux_dirent64 {
+  ino64_t        d_ino;
+  off64_t        d_off;
+  unsigned short d_reclen;
+  unsigned char  d_type;
+  char           d_name[1]; // actually d_reclen - 19 bytes long
+};
+
+/**
+ * @brief create a reader with a getdents64 buffer of bufSize bytes
+ *
+ * @param bufSize size of the buffer handed to each getdents64 call
+ */
+dirReader::dirReader(size_t bufSize) :
+  _fd(-1),
+  _buf(std::max(bufSize, offsetof(linux_dirent64, d_name) + NAME_MAX + 1)),
+  _pos(0),
+  _end(0),
+  _error(0),
+  _nCalls(0)
+  {}
+
+dirReader::~dirReader() {
+  close();
+}
+
+/**
+ * @brief read from an already open directory, which is left open
+ *
+ * @param fd descriptor of the directory, rewound to its first entry
+ *
+ * @return false with errno set if the directory could not be rewound
+ */
+bool dirReader::attach(int fd) {
+  close();
+  if (lseek(fd, 0, SEEK_SET) < 0) {
+    _error = errno;
+    return false;
+  }
+  _fd = fd;
+  return true;
+}
+
+/**
+ * @brief stop reading the directory, which is left open for its owner
+ */
+void dirReader::close() {
+  _fd = -1;
+  _pos = _end = 0;
+}
+
+/**
+ * @brief refill the buffer with the next batch of records
+ *
+ * @return true if any records were read
+ */
+bool dirReader::fill() {
+  long n = syscall(SYS_getdents64, _fd, _buf.data(), _buf.size());
+  ++_nCalls;
+  if (n < 0) {
+    _error = errno;
+    n = 0;
+  }
+  _pos = 0;
+  _end = n;
+  return n > 0;
+}
+
+/**
+ * @brief parse the next record out of the buffer, refilling it when empty
+ *
+ * @param ent entry to fill, its name points into the reader's buffer
+ *
+ * @return false at the end of the directory or on error, see error()
+ */
+bool dirReader::next(dirEntry & ent) {
+  if (_pos >= _end && (_fd < 0 || !fill())) {
+    return false;
+  }
+  const linux_dirent64 *d = (const linux_dirent64 *) &_buf[_pos];
+  _pos += d->d_reclen;
+
+  ent.name    = d->d_name;
+  ent.nameLen = strnlen(d->d_name, d->d_reclen - offsetof(linux_dirent64, d_name));
+  ent.type    = d->d_type;
+  ent.ino     = d->d_ino;
+  return true;
+}
@@ -0,0 +1,51 @@
+#ifndef DIRREADER_HPP
+#define DIRREADER_HPP
+
+#include <vector>
+
+#include <sys/types.h>
+#include <dirent.h>
+
+/**
+ * @brief a single directory record parsed in place from the getdents64 buffer
+ *
+ * name points into the reader's buffer and is only valid until the next call
+ * to dirReader::next() refills it
+ */
+struct dirEntry {
+  const char    *name;    // NUL terminated file name
+  size_t         nameLen; // length of name without the NUL
+  unsigned char  type;    // dirent type, may be DT_UNKNOWN
+  ino64_t        ino;     // inode number
+};
+
+class dirReader {
+  private:
+    int               _fd;     // directory being read, owned by the caller
+    std::vector<char> _buf;    // raw getdents64 records
+    size_t            _pos;    // offset of the next record in _buf
+    size_t            _end;    // number of valid bytes in _buf
+    int               _error;  // errno of the last failed syscall
+    size_t            _nCalls; // number of getdents64 calls made
+
+  private:
+    bool fill();
+
+  public:
+    // Large enough to drain most directories in a handful of syscalls
+    static const size_t defaultBufSize = 1 << 20;
+
+    dirReader(size_t bufSize = defaultBufSize);
+    ~dirReader();
+
+    bool attach(int fd);
+    bool next(dirEntry & ent);
+    void close();
+
+          int    error()  const { return _error; }
+          // records of the last getdents64 batch not yet returned by next()
+          bool   buffered() const { return _pos < _end; }
+          size_t nCalls() const { return _nCalls; }
+};
+
+#endif /* DIRREADER_HPP */
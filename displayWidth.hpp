@@ -0,0 +1,172 @@
+#ifndef DISPLAYWIDTH_HPP
+#define DISPLAYWIDTH_HPP
+
+#include <string_view>
+#include <string.h>
+#include <stdint.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "widthTab.hpp"
+
+/**
+ * Terminal cell widths of file names, for lining up columns. Names are
+ * almost always plain ASCII, where the width is the length, so that is
+ * settled with vector compares first and only names with other bytes are
+ * decoded as UTF-8.
+ */
+
+/**
+ * @brief cells taken by one code point, 0, 1 or 2
+ */
+inline unsigned codePointWidth(uint32_t cp) {
+  if (cp >= 0x110000) {
+    return 1;
+  }
+  return (widthBits[widthBlock[cp >> 8]][(cp & 0xff) >> 2] >> ((cp & 3) * 2)) & 3;
+}
+
+/**
+ * @brief check if all n bytes of s are ASCII
+ *
+ * Every byte is OR'd together with full width loads, the last load
+ * overlapping the one before, so short names take one or two loads and
+ * no per byte loop
+ */
+inline bool isAscii(const char *s, size_t n) {
+#ifdef __SSE2__
+  if (n >= 16) {
+    __m128i acc = _mm_loadu_si128((const __m128i *) (s + n - 16));
+    for (size_t i = 0; i + 16 < n; i += 16) {
+      acc = _mm_or_si128(acc, _mm_loadu_si128((const __m128i *) (s + i)));
+    }
+    return _mm_movemask_epi8(acc) == 0;
+  }
+#endif
+  uint64_t acc = 0;
+  if (n >= 8) {
+    uint64_t word;
+    memcpy(&word, s + n - 8, 8);
+    acc = word;
+    for (size_t i = 0; i + 8 < n; i += 8) {
+      memcpy(&word, s + i, 8);
+      acc |= word;
+    }
+  } else if (n >= 4) {
+    uint32_t head, tail;
+    memcpy(&head, s, 4);
+    memcpy(&tail, s + n - 4, 4);
+    acc = head | tail;
+  } else {
+    for (size_t i = 0; i < n; ++i) {
+      acc |= (unsigned char) s[i];
+    }
+  }
+  return (acc & 0x8080808080808080ull) == 0;
+}
+
+/**
+ * @brief length of the run of ASCII bytes at the start of s
+ */
+inline size_t asciiPrefix(const char *s, size_t n) {
+  size_t i = 0;
+#ifdef __AVX2__
+  for (; i + 32 <= n; i += 32) {
+    unsigned mask = _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *) (s + i)));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+#endif
+#ifdef __SSE2__
+  for (; i + 16 <= n; i += 16) {
+    unsigned mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) (s + i)));
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+#endif
+  for (; i + 8 <= n; i += 8) {
+    uint64_t word;
+    memcpy(&word, s + i, 8);
+    word &= 0x8080808080808080ull;
+    if (word != 0) {
+      return i + (__builtin_ctzll(word) >> 3);
+    }
+  }
+  while (i < n && !(s[i] & 0x80)) {
+    ++i;
+  }
+  return i;
+}
+
+/**
+ * @brief decode the UTF-8 sequence at s[i]
+ *
+ * @param cp set to the code point
+ *
+ * @return the sequence length, 0 if it isn't a valid sequence
+ */
+inline size_t decodeUtf8(const unsigned char *s, size_t i, size_t n, uint32_t & cp) {
+  unsigned char c = s[i];
+  size_t len;
+  uint32_t min;
+  if (c >= 0xc2 && c < 0xe0) {
+    len = 2; cp = c & 0x1f; min = 0x80;
+  } else if (c >= 0xe0 && c < 0xf0) {
+    len = 3; cp = c & 0x0f; min = 0x800;
+  } else if (c >= 0xf0 && c < 0xf5) {
+    len = 4; cp = c & 0x07; min = 0x10000;
+  } else {
+    return 0;
+  }
+  if (i + len > n) {
+    return 0;
+  }
+  for (size_t k = 1; k < len; ++k) {
+    if ((s[i + k] & 0xc0) != 0x80) {
+      return 0;
+    }
+    cp = (cp << 6) | (s[i + k] & 0x3f);
+  }
+  if (cp < min || cp > 0x10ffff || (cp >= 0xd800 && cp < 0xe000)) {
+    return 0;
+  }
+  return len;
+}
+
+/**
+ * @brief number of terminal cells name takes
+ *
+ * Bytes that aren't valid UTF-8 are counted as one cell each, as terminals
+ * show a replacement character for them
+ *
+ * @param name the name, in UTF-8
+ *
+ * @return the width in cells
+ */
+inline size_t displayWidth(std::string_view name) {
+  const char *s = name.data();
+  size_t n = name.size();
+  if (isAscii(s, n)) {
+    return n;
+  }
+  size_t i = asciiPrefix(s, n);
+  size_t width = i;
+  while (i < n) {
+    uint32_t cp;
+    size_t len = decodeUtf8((const unsigned char *) s, i, n, cp);
+    if (len == 0) {
+      // ASCII or a stray byte
+      ++width;
+      ++i;
+    } else {
+      width += codePointWidth(cp);
+      i += len;
+    }
+  }
+  return width;
+}
+
+#endif /* DISPLAYWIDTH_HPP */
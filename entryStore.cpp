@@ -0,0 +1,305 @@
+#include <algorithm>
+
+#include <string.h>
+
+#include "entryStore.hpp"
+
+namespace {
+
+/**
+ * @brief append n as a LEB128 varint
+ */
+void putVarint(std::string & out, uint64_t n) {
+  while (n >= 0x80) {
+    out += (char) (n | 0x80);
+    n >>= 7;
+  }
+  out += (char) n;
+}
+
+/**
+ * @brief read a LEB128 varint, advancing p past it
+ */
+uint64_t getVarint(const char *& p) {
+  uint64_t n = 0;
+  for (unsigned shift = 0; ; shift += 7) {
+    unsigned char c = *p++;
+    n |= (uint64_t) (c & 0x7f) << shift;
+    if (!(c & 0x80)) {
+      return n;
+    }
+  }
+}
+
+}
+
+/**
+ * @brief create an empty store
+ *
+ * @param mask the statx fields that will be fetched, decides which metadata
+ *             columns are kept
+ */
+entryStore::entryStore(unsigned int mask) :
+  _mask(mask),
+  _chunkUsed(0),
+  _chunkSize(0),
+  _chunkBytes(0)
+  {}
+
+/**
+ * @brief bump allocate room for a name, starting a new chunk when full
+ *
+ * @param size number of bytes needed, including the NUL
+ *
+ * @return the space, valid until the store is destroyed
+ */
+char * entryStore::allocName(size_t size) {
+  if (_chunkSize - _chunkUsed < size) {
+    _chunkSize = std::max(size, defaultChunkSize);
+    if (_chunkSize == defaultChunkSize && !_spare.empty()) {
+      _chunks.push_back(std::move(_spare.back()));
+      _spare.pop_back();
+    } else {
+      _chunks.emplace_back(new char[_chunkSize]);
+      _chunkBytes += _chunkSize;
+    }
+    _chunkUsed = 0;
+  }
+  char *name = _chunks.back().get() + _chunkUsed;
+  _chunkUsed += size;
+  return name;
+}
+
+/**
+ * @brief append an entry, copying its name into the arena
+ *
+ * @param dir the directory containing the file
+ * @param name the file's name, does not need to be NUL terminated
+ * @param nameLen length of name
+ * @param type the dirent type of the file
+ *
+ * @return the new entry's index
+ */
+uint32_t entryStore::add(const std::shared_ptr<dirHandle> & dir, const char *name,
+                         size_t nameLen, unsigned char type) {
+  uint32_t idx = size();
+
+  if (_dirs.empty() || _dirs.back() != dir) {
+    _dirs.push_back(dir);
+  }
+  _dirIdx.push_back(_dirs.size() - 1);
+
+  char *copy = allocName(nameLen + 1);
+  memcpy(copy, name, nameLen);
+  copy[nameLen] = '\0';
+  _name.push_back(copy);
+  _nameLen.push_back(nameLen);
+
+  _type.push_back(type);
+  _flags.push_back(0);
+  _fmt.push_back(NULL);
+
+  // Metadata columns are sized up front so stats can fill them in from
+  // several threads without reallocating
+  _mode.push_back(0);
+  if (_mask & STATX_NLINK) _nlink.push_back(0);
+  if (_mask & STATX_UID)   _uid.push_back(0);
+  if (_mask & STATX_GID)   _gid.push_back(0);
+  if (_mask & STATX_SIZE)  _size.push_back(0);
+  if (_mask & (STATX_MTIME | STATX_ATIME | STATX_CTIME | STATX_BTIME)) {
+    _timeSec.push_back(0);
+    _timeNsec.push_back(0);
+  }
+  return idx;
+}
+
+/**
+ * @brief append a copy of an entry of another store, metadata included
+ *
+ * Both stores are expected to keep the same metadata columns
+ *
+ * @param from the store holding the entry
+ * @param idx the entry's index in from
+ *
+ * @return the copy's index
+ */
+uint32_t entryStore::copy(const entryStore & from, uint32_t idx) {
+  return copy(from, idx, from._dirs[from._dirIdx[idx]],
+              std::string_view(from._name[idx], from._nameLen[idx]));
+}
+
+/**
+ * @brief append a copy of an entry of another store under a new name
+ *
+ * Used to move an entry to a directory further up, named by its path from
+ * there, without stat'ing it again
+ *
+ * @param from the store holding the entry
+ * @param idx the entry's index in from
+ * @param dir the directory the copy is in
+ * @param name the copy's name relative to dir
+ *
+ * @return the copy's index
+ */
+uint32_t entryStore::copy(const entryStore & from, uint32_t idx,
+                          const std::shared_ptr<dirHandle> & dir, std::string_view name) {
+  uint32_t copyIdx = add(dir, name.data(), name.size(), from._type[idx]);
+  _flags[copyIdx] = from._flags[idx];
+  _fmt[copyIdx]   = from._fmt[idx];
+  _mode[copyIdx]  = from._mode[idx];
+  if (!_nlink.empty()) _nlink[copyIdx] = from._nlink[idx];
+  if (!_uid.empty())   _uid[copyIdx]   = from._uid[idx];
+  if (!_gid.empty())   _gid[copyIdx]   = from._gid[idx];
+  if (!_size.empty())  _size[copyIdx]  = from._size[idx];
+  if (!_timeSec.empty()) {
+    _timeSec[copyIdx]  = from._timeSec[idx];
+    _timeNsec[copyIdx] = from._timeNsec[idx];
+  }
+  return copyIdx;
+}
+
+/**
+ * @brief copy the fields the store keeps out of a statx result
+ *
+ * @param idx the entry's index
+ * @param stats the statx result
+ * @param timeField which of the timestamps to keep, a fileEnt::timeField
+ */
+void entryStore::setStat(uint32_t idx, const struct statx & stats, int timeField) {
+  _mode[idx] = stats.stx_mode;
+  if (!_nlink.empty()) _nlink[idx] = stats.stx_nlink;
+  if (!_uid.empty())   _uid[idx]   = stats.stx_uid;
+  if (!_gid.empty())   _gid[idx]   = stats.stx_gid;
+  if (!_size.empty())  _size[idx]  = stats.stx_size;
+  if (!_timeSec.empty()) {
+    const struct statx_timestamp *times[] = {
+      &stats.stx_mtime, &stats.stx_atime, &stats.stx_ctime, &stats.stx_btime};
+    _timeSec[idx]  = times[timeField]->tv_sec;
+    _timeNsec[idx] = times[timeField]->tv_nsec;
+  }
+  _flags[idx] |= entryFlags::hasStat;
+}
+
+/**
+ * @brief zero an entry's metadata after a failed stat
+ *
+ * @param idx the entry's index
+ */
+void entryStore::clearStat(uint32_t idx) {
+  struct statx stats;
+  memset(&stats, 0, sizeof(stats));
+  setStat(idx, stats, 0);
+}
+
+/**
+ * @brief drop every entry, keeping the memory of the columns and chunks
+ *
+ * Names handed out before are overwritten by the next entries added
+ */
+void entryStore::clear() {
+  // Every chunk holds at least defaultChunkSize, they are handed out again
+  // as that size
+  for (std::unique_ptr<char[]> & chunk : _chunks) {
+    _spare.push_back(std::move(chunk));
+  }
+  _chunks.clear();
+  _chunkUsed = 0;
+  _chunkSize = 0;
+
+  _name.clear();
+  _nameLen.clear();
+  _dirIdx.clear();
+  _type.clear();
+  _flags.clear();
+  _fmt.clear();
+  _width.clear();
+  _mode.clear();
+  _nlink.clear();
+  _uid.clear();
+  _gid.clear();
+  _size.clear();
+  _timeSec.clear();
+  _timeNsec.clear();
+  _dirs.clear();
+}
+
+/**
+ * @brief append an entry's columns to out in a compact form
+ *
+ * Numbers are written as varints and the metadata only if the entry was
+ * stat'd. The format pointer is written as is, so packed entries are only
+ * read back by the process that wrote them.
+ *
+ * @param idx the entry's index
+ * @param out the packed entry is appended here
+ */
+void entryStore::pack(uint32_t idx, std::string & out) const {
+  putVarint(out, _nameLen[idx]);
+  out.append(_name[idx], _nameLen[idx]);
+  out += (char) _type[idx];
+  out += (char) _flags[idx];
+  out.append((const char *) &_fmt[idx], sizeof(_fmt[idx]));
+  if (!(_flags[idx] & entryFlags::hasStat)) {
+    return;
+  }
+
+  putVarint(out, _mode[idx]);
+  if (!_nlink.empty()) putVarint(out, _nlink[idx]);
+  if (!_uid.empty())   putVarint(out, _uid[idx]);
+  if (!_gid.empty())   putVarint(out, _gid[idx]);
+  if (!_size.empty())  putVarint(out, _size[idx]);
+  if (!_timeSec.empty()) {
+    // Zigzag encoded, times before 1970 are negative
+    putVarint(out, ((uint64_t) _timeSec[idx] << 1) ^ (uint64_t) (_timeSec[idx] >> 63));
+    putVarint(out, _timeNsec[idx]);
+  }
+}
+
+/**
+ * @brief append an entry packed by pack() in a store with the same mask
+ *
+ * @param dir the directory containing the file
+ * @param rec the packed entry
+ *
+ * @return the new entry's index
+ */
+uint32_t entryStore::unpack(const std::shared_ptr<dirHandle> & dir, const char *rec) {
+  size_t nameLen = getVarint(rec);
+  const char *name = rec;
+  rec += nameLen;
+  unsigned char type = *rec++;
+  uint32_t idx = add(dir, name, nameLen, type);
+  _flags[idx] = *rec++;
+  memcpy(&_fmt[idx], rec, sizeof(_fmt[idx]));
+  rec += sizeof(_fmt[idx]);
+  if (!(_flags[idx] & entryFlags::hasStat)) {
+    return idx;
+  }
+
+  _mode[idx] = getVarint(rec);
+  if (!_nlink.empty()) _nlink[idx] = getVarint(rec);
+  if (!_uid.empty())   _uid[idx]   = getVarint(rec);
+  if (!_gid.empty())   _gid[idx]   = getVarint(rec);
+  if (!_size.empty())  _size[idx]  = getVarint(rec);
+  if (!_timeSec.empty()) {
+    uint64_t sec = getVarint(rec);
+    _timeSec[idx]  = (int64_t) (sec >> 1) ^ -(int64_t) (sec & 1);
+    _timeNsec[idx] = getVarint(rec);
+  }
+  return idx;
+}
+
+/**
+ * @brief memory held by the entries' columns and name chunks
+ *
+ * Columns count at their capacity and chunks at their full size, spare
+ * ones and those made for long names included, so a store emptied by
+ * clear() still counts all that it holds
+ */
+size_t entryStore::bytes() const {
+  auto held = [](const auto & column) { return column.capacity() * sizeof(column[0]); };
+  return held(_name) + held(_nameLen) + held(_dirIdx) + held(_type) + held(_flags) +
+         held(_fmt) + held(_width) + held(_mode) + held(_nlink) + held(_uid) + held(_gid) +
+         held(_size) + held(_timeSec) + held(_timeNsec) + held(_dirs) +
+         held(_chunks) + held(_spare) + _chunkBytes;
+}
@@ -0,0 +1,91 @@
+#ifndef ENTRYSTORE_HPP
+#define ENTRYSTORE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "format.hpp"
+#include "dirHandle.hpp"
+
+/**
+ * @brief column store holding the entries of a listing
+ *
+ * Each field lives in its own array indexed by the entry's 32-bit index, so
+ * sorts and printers only touch the columns they compare or print. Names
+ * are bump allocated NUL terminated into large chunks that never move, so
+ * views of them stay valid for the store's lifetime, and the metadata
+ * columns only exist for the fields in the statx mask the store was created
+ * with. Entries are read and written through fileEnt handles.
+ */
+class entryStore {
+  private:
+    enum entryFlags : uint8_t {
+      hasStat = 1      // metadata columns have been filled in
+    };
+
+    unsigned int               _mask;     // statx fields with a column
+
+    // Name arena, names are packed back to back into the last chunk
+    std::vector<std::unique_ptr<char[]> > _chunks;
+    size_t                     _chunkUsed; // bytes handed out of the last chunk
+    size_t                     _chunkSize; // size of the last chunk
+    std::vector<std::unique_ptr<char[]> > _spare; // chunks freed by clear()
+    size_t                     _chunkBytes; // full size of every chunk, spare ones too
+
+    // Always present
+    std::vector<const char *>  _name;     // NUL terminated name in the arena
+    std::vector<uint32_t>      _nameLen;  // length of each name
+    std::vector<uint32_t>      _dirIdx;   // index into _dirs
+    std::vector<uint8_t>       _type;     // dirent type
+    std::vector<uint8_t>       _flags;    // entryFlags
+    std::vector<const fileFmt *> _fmt;    // associated format struct
+
+    // Display width of each name, only filled in by listings that line up
+    // columns, unknownWidth until measured
+    std::vector<uint16_t>      _width;
+
+    // Only filled in for the fields in _mask
+    std::vector<uint16_t>      _mode;
+    std::vector<uint32_t>      _nlink;
+    std::vector<uint32_t>      _uid;
+    std::vector<uint32_t>      _gid;
+    std::vector<uint64_t>      _size;
+    std::vector<int64_t>       _timeSec;  // the timestamp selected by -u/-c/--time
+    std::vector<uint32_t>      _timeNsec;
+
+    // Directories the entries are in, usually just the one
+    std::vector<std::shared_ptr<dirHandle> > _dirs;
+
+  private:
+    char * allocName(size_t size);
+
+  public:
+    // Names are carved out of chunks of this size, longer ones get their own
+    static constexpr size_t defaultChunkSize = 1 << 16;
+    static constexpr uint16_t unknownWidth = 0xffff;
+
+    entryStore(unsigned int mask);
+
+    uint32_t add(const std::shared_ptr<dirHandle> & dir, const char *name, size_t nameLen,
+                 unsigned char type);
+    uint32_t copy(const entryStore & from, uint32_t idx);
+    uint32_t copy(const entryStore & from, uint32_t idx,
+                  const std::shared_ptr<dirHandle> & dir, std::string_view name);
+    void     setStat(uint32_t idx, const struct statx & stats, int timeField);
+    void     clearStat(uint32_t idx);
+    void     clear();
+
+    void     pack(uint32_t idx, std::string & out) const;
+    uint32_t unpack(const std::shared_ptr<dirHandle> & dir, const char *rec);
+
+    size_t   size() const { return _type.size(); }
+    size_t   bytes() const;
+
+    friend class fileEnt;
+};
+
+#endif /* ENTRYSTORE_HPP */
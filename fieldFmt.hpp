@@ -0,0 +1,155 @@
+#ifndef FIELDFMT_HPP
+#define FIELDFMT_HPP
+
+#include <string.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <sys/types.h>
+
+/**
+ * Formatters for the long listing fields. Each writes straight into a
+ * caller provided buffer, returns the number of bytes written and never
+ * allocates. Everything they look up is built at compile time.
+ */
+
+/**
+ * @brief the nine rwx characters for every combination of permission bits
+ */
+struct permTable {
+  char chars[512][9];
+
+  constexpr permTable() : chars{} {
+    const char rwx[] = {'r', 'w', 'x'};
+    for (unsigned mode = 0; mode < 512; ++mode) {
+      for (unsigned i = 0; i < 9; ++i) {
+        chars[mode][i] = (mode >> (8 - i)) & 1 ? rwx[i % 3] : '-';
+      }
+    }
+  }
+};
+
+/**
+ * @brief decimal digit pairs "00" through "99"
+ */
+struct digitTable {
+  char pairs[200];
+
+  constexpr digitTable() : pairs{} {
+    for (unsigned i = 0; i < 100; ++i) {
+      pairs[2 * i]     = '0' + i / 10;
+      pairs[2 * i + 1] = '0' + i % 10;
+    }
+  }
+};
+
+inline constexpr permTable  permChars;
+inline constexpr digitTable digitPairs;
+
+// ls type character for each dirent type, regular files and unknowns are '-'
+inline constexpr char typeChars[16] = {
+  '-', 'p', 'c', '-', 'd', '-', 'b', '-', '-', '-', 'l', '-', 's', '-', '-', '-'
+};
+
+inline constexpr uint64_t powersOf10[20] = {
+  1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+  100000000ull, 1000000000ull, 10000000000ull, 100000000000ull,
+  1000000000000ull, 10000000000000ull, 100000000000000ull,
+  1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+  1000000000000000000ull, 10000000000000000000ull
+};
+
+// Longest output of each formatter
+const size_t modeWidth    = 10;
+const size_t decimalMax   = 20;
+const size_t sizeWidth    = 8;
+
+/**
+ * @brief number of decimal digits in val, without dividing
+ *
+ * The bit length gives the digit count to within one, a single compare
+ * against a power of ten settles it. val | 1 keeps 0 at one digit and never
+ * crosses a power of ten.
+ */
+inline size_t decimalWidth(uint64_t val) {
+  uint64_t v = val | 1;
+  unsigned t = ((64 - __builtin_clzll(v)) * 1233) >> 12;
+  return t - (v < powersOf10[t]) + 1;
+}
+
+/**
+ * @brief write val in decimal, two digits at a time
+ *
+ * @param dst room for decimalMax bytes
+ * @param val the number
+ *
+ * @return bytes written
+ */
+inline size_t fmtDecimal(char *dst, uint64_t val) {
+  size_t len = decimalWidth(val);
+  char *pos = dst + len;
+  while (val >= 100) {
+    const char *pair = &digitPairs.pairs[2 * (val % 100)];
+    val /= 100;
+    *--pos = pair[1];
+    *--pos = pair[0];
+  }
+  if (val >= 10) {
+    *--pos = digitPairs.pairs[2 * val + 1];
+    *--pos = digitPairs.pairs[2 * val];
+  } else {
+    *--pos = '0' + val;
+  }
+  return len;
+}
+
+/**
+ * @brief write val in decimal right aligned to width with spaces
+ *
+ * @param dst room for the larger of width and decimalMax bytes
+ *
+ * @return bytes written
+ */
+inline size_t fmtDecimal(char *dst, uint64_t val, size_t width) {
+  size_t len = decimalWidth(val);
+  size_t padLen = width > len ? width - len : 0;
+  memset(dst, ' ', padLen);
+  return padLen + fmtDecimal(dst + padLen, val);
+}
+
+/**
+ * @brief write the ls style mode string, ex drwxr-xr-x
+ *
+ * @param dst room for modeWidth bytes
+ * @param type the dirent type
+ * @param mode the mode bits
+ *
+ * @return bytes written
+ */
+inline size_t fmtMode(char *dst, unsigned char type, mode_t mode) {
+  dst[0] = typeChars[type & 15];
+  memcpy(dst + 1, permChars.chars[mode & 0777], 9);
+  return modeWidth;
+}
+
+/**
+ * @brief write a size scaled to the largest unit it exceeds, ex "  12 KiB"
+ *
+ * @param dst room for sizeWidth bytes
+ * @param size the size in bytes
+ *
+ * @return bytes written
+ */
+inline size_t fmtSize(char *dst, uint64_t size) {
+  static const char units[][4] = {"  B", "KiB", "MiB", "GiB", "TiB", "PiB", "XiB"};
+  size_t unit = 0;
+  while (size > 1024 && unit < sizeof(units) / sizeof(*units) - 1) {
+    ++unit;
+    size >>= 10;
+  }
+  size_t len = fmtDecimal(dst, size, 4);
+  dst[len] = ' ';
+  memcpy(dst + len + 1, units[unit], 3);
+  return len + 4;
+}
+
+#endif /* FIELDFMT_HPP */
@@ -5,80 +5,226 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <pwd.h>
 #include <dirent.h>
-#include <grp.h>
 #include <time.h>
 #include <unistd.h>
 #include <assert.h>
 
 #include "fileEnt.hpp"
+#include "fieldFmt.hpp"
+#include "displayWidth.hpp"
 #include "format.hpp"
 
-std::unordered_map<uid_t, std::string> fileEnt::userNames;
-std::unordered_map<gid_t, std::string> fileEnt::groupNames;
-
-fileEnt::fileEnt(std::string dir, std::string name, unsigned char type) :
-  _path(dir + "/" + name),
-  _name(name),
-  _type(type),
-  _nSuffixIcons(0)
-  {
-    if (stat(_path.c_str(), &_stat) < 0) {
-      perror("fileEnt::fileEnt");
-    };
-    if (isLink()) {
-      ++_nSuffixIcons;
-    }
-    if (isVisible()) {
-      ++_nSuffixIcons;
-    }
+idResolver                             fileEnt::ids;
+
+unsigned int       fileEnt::statxMask = STATX_BASIC_STATS;
+fileEnt::timeField fileEnt::timeSel   = fileEnt::timeField::modTime;
+timeFmt            fileEnt::timeRender;
+
+/**
+ * @brief set the fields statx should fetch for every entry
+ *
+ * @param mask STATX_* bits needed by the output and sort keys
+ */
+void fileEnt::setStatxMask(unsigned int mask) { statxMask = mask; }
+
+/**
+ * @brief select the timestamp shown in long listings and used by -t
+ *
+ * @param field the timestamp to use
+ */
+void fileEnt::setTimeField(timeField field) { timeSel = field; }
+fileEnt::timeField fileEnt::getTimeField() { return timeSel; }
+
+/**
+ * @brief select how long listings show timestamps
+ *
+ * @param style a --time-style argument
+ *
+ * @return false if style isn't recognized
+ */
+bool fileEnt::setTimeStyle(const std::string & style) { return timeRender.setStyle(style); }
+
+/**
+ * @brief show owners and groups as numeric IDs, as with -n
+ */
+void fileEnt::setNumericIds(bool numeric) { ids.setNumeric(numeric); }
+
+/**
+ * @brief keep owner and group names in a disk cache for ttl seconds
+ */
+void fileEnt::setIdCache(time_t ttl) { ids.setCache(ttl); }
+
+/**
+ * @brief look up the names of a listing's owners and groups together
+ *
+ * @param uids every owner in the listing, duplicates are fine
+ * @param gids every group in the listing, duplicates are fine
+ */
+void fileEnt::resolveIds(std::vector<uint32_t> & uids, std::vector<uint32_t> & gids) {
+  ids.resolve(idResolver::user, uids);
+  ids.resolve(idResolver::group, gids);
+}
+unsigned int       fileEnt::getStatxMask() { return statxMask; }
+
+/**
+ * @brief stat the file, only done the first time its metadata is needed
+ */
+void fileEnt::loadStat() const {
+  dirHandle::pinGuard dir(*getDir());
+  statAt(dir.fd());
+}
+
+/**
+ * @brief stat the file relative to its already pinned directory
+ *
+ * Only the fields in statxMask are requested, and cached attributes are
+ * accepted so network filesystems don't need a round trip to the server
+ *
+ * @param dirfd descriptor of the directory containing the file
+ */
+void fileEnt::statAt(int dirfd) const {
+  struct statx stats;
+  if (statx(dirfd, nameStr(), AT_STATX_DONT_SYNC, statxMask, &stats) < 0) {
+    perror("fileEnt::fileEnt");
+    _store->clearStat(_idx);
+  } else {
+    _store->setStat(_idx, stats, timeSel);
   }
+}
 
-fileEnt::~fileEnt(){}
+/**
+ * @brief fill in the dirent type for filesystems that don't support d_type
+ *
+ * Only the type of the entry itself is requested, links are not followed
+ */
+void fileEnt::resolveType() const {
+  struct statx lstats;
+  dirHandle::pinGuard dir(*getDir());
+  if (statx(dir.fd(), nameStr(), AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC,
+            STATX_TYPE, &lstats) < 0) {
+    return;
+  }
+  _store->_type[_idx] = IFTODT(lstats.stx_mode);
+}
+
+/**
+ * @brief check if the file's metadata has already been loaded
+ *
+ * @return true if the file has been stat'd
+ */
+bool fileEnt::hasStat() const {
+  return _store->_flags[_idx] & entryStore::entryFlags::hasStat;
+}
+
+/**
+ * @brief get the file type bits of the stat mode
+ *
+ * The dirent type is used when it is known, so the file is only stat'd for
+ * links (whose target decides the type) and filesystems without d_type
+ *
+ * @return the S_IFMT bits of the file's mode
+ */
+mode_t fileEnt::getFileMode() const {
+  unsigned char type = getType();
+  if (type == DT_UNKNOWN || type == DT_LNK) {
+    return getMode() & S_IFMT;
+  }
+  return DTTOIF(type);
+}
 
 /**
  * @brief name getter
  *
- * @return the file's name ex file.c
+ * @return the file's name ex file.c, valid for as long as its store
  */
-std::string fileEnt::getName() const { return _name; }
-std::string fileEnt::getPath() const { return _path; }
+std::string_view fileEnt::getName() const {
+  return std::string_view(nameStr(), _store->_nameLen[_idx]);
+}
 
+/**
+ * @brief build the file's full path, only needed for display
+ *
+ * @return the path of the file ex a/b/c/file.c
+ */
+std::string fileEnt::getPath() const { return getDir()->getPath() + "/" + nameStr(); }
 
 /**
- * @brief get the dirent type of the file
+ * @brief get the directory the file is in
  *
- * @return type field from the file's dirent
+ * @return the handle entries are stat'd relative to
  */
-unsigned char fileEnt::getType() const { return _type; }
+const std::shared_ptr<dirHandle> & fileEnt::getDir() const {
+  return _store->_dirs[_store->_dirIdx[_idx]];
+}
 
+/**
+ * @brief get the entry's index in its store
+ *
+ * @return the 32-bit index sorts and filters work with
+ */
+uint32_t fileEnt::getIndex() const { return _idx; }
 
 /**
- * @brief get the number of suffix icons for the file
+ * @brief get a handle for listing the file as a directory
  *
- * @return number of suffix icons to follow the filename
+ * @return a handle opened relative to the file's directory
  */
-const size_t & fileEnt::getNSuffixIcons() const { return _nSuffixIcons; }
+std::shared_ptr<dirHandle> fileEnt::subdir() const {
+  return dirHandle::child(getDir(), nameStr());
+}
 
 
 /**
- * @brief get the suffix icons for the file
+ * @brief get the dirent type of the file
  *
- * @return a list of icons padded with a space afterward
+ * @return type field from the file's dirent, looked up if it was unknown
  */
-std::string fileEnt::getSuffixIcons() const {
-  if (_nSuffixIcons == 0) {
-    return "";
+unsigned char fileEnt::getType() const {
+  if (_store->_type[_idx] == DT_UNKNOWN) {
+    resolveType();
   }
-  std::string icons = "";
-  if (isLink()) {
-    icons += " " LINK_ICON;
+  return _store->_type[_idx];
+}
+
+/**
+ * @brief terminal cells the name takes, measured once per entry
+ *
+ * @return the name's display width
+ */
+size_t fileEnt::getWidth() const {
+  std::vector<uint16_t> & widths = _store->_width;
+  if (widths.size() <= _idx) {
+    widths.resize(_store->size(), entryStore::unknownWidth);
   }
-  if (isVisible()) {
-    icons += " " VISIBLE_ICON;
+  if (widths[_idx] == entryStore::unknownWidth) {
+    // Wider than any terminal, the width is only needed to fill a column
+    widths[_idx] = std::min(displayWidth(getName()), (size_t) entryStore::unknownWidth - 1);
   }
-  return icons;
+  return widths[_idx];
+}
+
+/**
+ * @brief terminal cells taken by the suffix icons
+ *
+ * @return the display width of getSuffixIcons()
+ */
+size_t fileEnt::getSuffixWidth() const {
+  static const size_t widths[] = {
+    displayWidth(""), displayWidth(" " LINK_ICON), displayWidth(" " VISIBLE_ICON),
+    displayWidth(" " LINK_ICON " " VISIBLE_ICON)};
+  return widths[isLink() | isVisible() << 1];
+}
+
+/**
+ * @brief get the suffix icons for the file
+ *
+ * @return the icons, each preceded by a space
+ */
+std::string_view fileEnt::getSuffixIcons() const {
+  static const std::string_view icons[] = {
+    "", " " LINK_ICON, " " VISIBLE_ICON, " " LINK_ICON " " VISIBLE_ICON};
+  return icons[isLink() | isVisible() << 1];
 }
 
 /**
@@ -87,7 +233,7 @@ std::string fileEnt::getSuffixIcons() const {
  * @param fmt the format entry to use
  */
 void fileEnt::setFmt(const fileFmt *fmt) { 
-  _fmt = fmt;
+  _store->_fmt[_idx] = fmt;
 }
 
 /**
@@ -99,12 +245,13 @@ void fileEnt::setFmt(const fileFmt *fmt) {
  */
 std::string fileEnt::formatted(size_t length) const {
   std::string padding = "";
-  size_t suffixLen = getNSuffixIcons() > 0 ? 2 * getNSuffixIcons() : 0;
-  ssize_t padLen = length - _name.length() - suffixLen;
+  ssize_t padLen = length - getWidth() - getSuffixWidth();
   if (padLen >= 0) {
     padding.resize(padLen, ' ');
   }
-  return getEmphasis() + _fmt->fmt + _fmt->icon + " " + _name + getSuffixIcons() + padding;
+  std::string str(getEmphasis());
+  str.append(getColor()).append(getIcon()).append(" ").append(getName());
+  return str.append(getSuffixIcons()).append(padding);
 }
 
 /**
@@ -112,39 +259,73 @@ std::string fileEnt::formatted(size_t length) const {
  *
  * @return the entries color format field
  */
-const std::string & fileEnt::getColor() const {
-  return _fmt->fmt;
+std::string_view fileEnt::getColor() const {
+  return _store->_fmt[_idx]->fmt;
 }
 
 
+namespace {
+
 /**
- * @brief return the color format for the permissions bits
- *
- * @return the correct format for the file's permissions
+ * @brief the caller's effective IDs and supplementary groups, read once
  */
-const std::string & fileEnt::getPermColor() const {
-  // TODO get the current user's permissions so may need to check group/others
-  switch ((_stat.st_mode >> 6) & 7) {
-    case 7:
-      return RWX_PERM;
-    case 6:
-      return RW_PERM;
-    case 5:
-      return RX_PERM;
-    case 4:
-      return R_PERM;
-    case 3:
-      return WX_PERM;
-    case 2:
-      return W_PERM;
-    case 1:
-      return X_PERM;
-    case 0:
-      return NO_PERM;
+struct credentials {
+  uid_t              uid;
+  gid_t              gid;
+  std::vector<gid_t> groups;    // sorted
+
+  credentials() : uid(geteuid()), gid(getegid()) {
+    int n = getgroups(0, NULL);
+    if (n > 0) {
+      groups.resize(n);
+      n = getgroups(n, groups.data());
+      groups.resize(n > 0 ? n : 0);
+    }
+    std::sort(groups.begin(), groups.end());
+  }
+
+  bool inGroup(gid_t id) const {
+    return id == gid || std::binary_search(groups.begin(), groups.end(), id);
   }
 
-  /* Should never get here */
-  assert(0);
+  /**
+   * @brief the rwx bits the caller gets on a file, as the kernel checks them
+   *
+   * Root may read and write anything and execute anything with an x bit
+   * set, ACLs aren't taken into account
+   */
+  unsigned access(mode_t mode, uid_t owner, gid_t group) const {
+    if (uid == 0) {
+      return 6 | ((mode & 0111) || S_ISDIR(mode) ? 1 : 0);
+    }
+    if (uid == owner) {
+      return (mode >> 6) & 7;
+    }
+    if (inGroup(group)) {
+      return (mode >> 3) & 7;
+    }
+    return mode & 7;
+  }
+};
+
+// Color for each combination of rwx bits
+const std::string_view permColors[8] = {
+  NO_PERM, X_PERM, W_PERM, WX_PERM, R_PERM, RX_PERM, RW_PERM, RWX_PERM
+};
+
+}
+
+/**
+ * @brief return the color format for the caller's access to the file
+ *
+ * Access is worked out from the mode, owner and group already in the store
+ * against credentials read once, so it costs no syscall per file
+ *
+ * @return the correct format for the caller's permissions
+ */
+std::string_view fileEnt::getPermColor() const {
+  static const credentials creds;
+  return permColors[creds.access(getMode(), getUid(), getGid())];
 }
 
 /**
@@ -152,8 +333,8 @@ const std::string & fileEnt::getPermColor() const {
  *
  * @return the entries icon format field
  */
-const std::string & fileEnt::getIcon() const {
-  return _fmt->icon;
+std::string_view fileEnt::getIcon() const {
+  return _store->_fmt[_idx]->icon;
 }
 
 /**
@@ -162,10 +343,11 @@ const std::string & fileEnt::getIcon() const {
  * @return a pointer to the fileType entry for the file
  */
 const fileType * fileEnt::getFileType() const {
-  if (_fmt == NULL) {
+  const fileFmt *fmt = _store->_fmt[_idx];
+  if (fmt == NULL) {
     return NULL;
   } else {
-    return _fmt->parent;
+    return fmt->parent;
   }
 }
 
@@ -188,136 +370,40 @@ const char * fileEnt::getLink() const {
  * @return true if the file is a link
  */
 bool fileEnt::isLink() const {
-  struct stat lstats;
-  switch(_type) {
-    case DT_UNKNOWN:
-      // Only used for filesystems that don't support d_type in dirents
-      // Requires an extra call to stat
-      lstat(_path.c_str(), &lstats);
-      return S_ISLNK(lstats.st_mode);
-    case DT_LNK:
-      return true;
-    default:
-      return false;
-  }
+  return getType() == DT_LNK;
 }
 
 bool fileEnt::isDir() const {
-  struct stat lstats;
-  switch(_type) {
-    case DT_UNKNOWN:
-      // Only used for filesystems that don't support d_type in dirents
-      // Requires an extra call to stat
-      lstat(_path.c_str(), &lstats);
-      return S_ISDIR(lstats.st_mode);
-    case DT_DIR:
-      return true;
-    default:
-      return false;
-  }
+  return getType() == DT_DIR;
 }
 
 /**
- * @brief extract the permissions bits fromt the type and stat mode
- *
- * @return human readable permissions bits string
- */
-std::string fileEnt::getPermissionString() const {
-  struct stat lstats;
-  std::string permStr = "";
-
-  // Set the type char
-  switch(_type) {
-    case DT_LNK:
-      permStr += 'l';
-      break;
-    case DT_DIR:
-      permStr += 'd';
-      break;
-    case DT_BLK:
-      permStr += 'b';
-      break;
-    case DT_CHR:
-      permStr += 'c';
-      break;
-    case DT_SOCK:
-      permStr += 's';
-      break;
-    case DT_FIFO:
-      permStr += 'p';
-      break;
-    case DT_UNKNOWN:
-      // lstat the file if no dirent data
-      lstat(_path.c_str(), &lstats);
-      switch(lstats.st_mode) {
-        case S_IFLNK:
-          permStr += 'l';
-          break;
-        case S_IFDIR:
-          permStr += 'd';
-          break;
-        case S_IFBLK:
-          permStr += 'b';
-          break;
-        case S_IFCHR:
-          permStr += 'c';
-          break;
-        case S_IFSOCK:
-          permStr += 's';
-          break;
-        case S_IFIFO:
-          permStr += 'p';
-          break;
-        default:
-          permStr += '-';
-      }
-      break;
-    case DT_REG:
-      /* fallthrough */
-    default:
-      permStr += '-';
-  }
-
-  // Set the permissions chars
-  char permChars[] = {'x', 'w', 'r'};
-  mode_t st_mode = getStat().st_mode;
-  for (int permSet = 2; permSet >= 0; --permSet) {
-    for (int permBit = 2; permBit >= 0; --permBit) {
-      if ((st_mode >> (permSet * 3 + permBit)) & 0x1) {
-        permStr += permChars[permBit];
-      } else {
-        permStr +=  '-';
-      }
-    }
-  }
-
-  return permStr;
+ * @brief write the permissions string from the type and stat mode
+ *
+ * @param buf room for modeWidth bytes
+ *
+ * @return bytes written, ex drwxr-xr-x
+ */
+size_t fileEnt::fmtPermissions(char *buf) const {
+  return fmtMode(buf, getType(), getMode());
 }
 
 /**
- * @brief either look up the user in the static map or via syscall
+ * @brief the owner's name, or the uid as a number if it has none
  *
- * @return the file owner's name
+ * @return the file owner's name, valid for the rest of the run
  */
-std::string & fileEnt::getOwnerName() const {
-  uid_t id = getStat().st_uid;
-  if (userNames.find(id) == userNames.end()) {
-    userNames[id] = std::string(getpwuid(getStat().st_uid)->pw_name);
-  }
-  return userNames[id];
+const std::string & fileEnt::getOwnerName() const {
+  return ids.name(idResolver::user, getUid());
 }
 
 /**
- * @brief either look up the group in the static map or via syscall
+ * @brief the group's name, or the gid as a number if it has none
  *
- * @return the file's group name
+ * @return the file's group name, valid for the rest of the run
  */
-std::string & fileEnt::getGroupName() const {
-  gid_t id = getStat().st_gid;
-  if (groupNames.find(id) == groupNames.end()) {
-    groupNames[id] = std::string(getgrgid(id)->gr_name);
-  }
-  return groupNames[id];
+const std::string & fileEnt::getGroupName() const {
+  return ids.name(idResolver::group, getGid());
 }
 
 /**
@@ -326,7 +412,7 @@ std::string & fileEnt::getGroupName() const {
  * @return true if others have any permissions for the file
  */
 bool fileEnt::isVisible() const {
-  if ((getStat().st_mode & 0x7) != 0) {
+  if ((getMode() & 0x7) != 0) {
     return true;
   } else {
     return false;
@@ -339,7 +425,7 @@ bool fileEnt::isVisible() const {
  * @return bold if the file is executable or nothing otherwise
  */
 const char * fileEnt::getEmphasis() const {
-  if (getStat().st_mode >> 6 & 0x1 && _type != DT_DIR) {
+  if (getMode() >> 6 & 0x1 && getType() != DT_DIR) {
     return BOLD;
   } else {
     return NO_EMPH;
@@ -347,82 +433,95 @@ const char * fileEnt::getEmphasis() const {
 }
 
 /**
- * @brief get a human readable file size
+ * @brief write a human readable file size
  *
- * @return padded human readable file size
+ * @param buf room for sizeWidth bytes
+ *
+ * @return bytes written, ex "  12 KiB"
  */
-std::string fileEnt::getSizeStr() const {
-  const char *prefix[] = {"  B", "KiB", "MiB", "GiB", "TiB", "PiB", "XiB"};
-  off_t size = getStat().st_size;
-  size_t i = 0;
-  while(size > 1024 && i < sizeof(prefix) - 1) {
-    i++;
-    size >>= 10;
-  }
-  std::string str = std::to_string(size);
-  while(str.length() < 4) {
-   str = " " + str;
-  }
-  return str + " " + prefix[i];
+size_t fileEnt::fmtSize(char *buf) const {
+  return ::fmtSize(buf, getSize());
+}
+
+/**
+ * @brief metadata column getters, stat the file on first use
+ *
+ * Columns outside the statx mask the store was created with read as 0
+ */
+mode_t fileEnt::getMode() const {
+  needStat();
+  return _store->_mode[_idx];
+}
+
+uid_t fileEnt::getUid() const {
+  needStat();
+  return _store->_uid.empty() ? 0 : _store->_uid[_idx];
+}
+
+gid_t fileEnt::getGid() const {
+  needStat();
+  return _store->_gid.empty() ? 0 : _store->_gid[_idx];
+}
+
+nlink_t fileEnt::getNLink() const {
+  needStat();
+  return _store->_nlink.empty() ? 0 : _store->_nlink[_idx];
 }
 
 off_t fileEnt::getSize() const {
-  return getStat().st_size;
+  needStat();
+  return _store->_size.empty() ? 0 : _store->_size[_idx];
 }
 
 /**
- * @brief get the number of hard links to the file
+ * @brief write the number of hard links to the file
  *
- * @param padding amount to pad the string to fit nicely in a column
+ * @param buf room for the larger of width and decimalMax bytes
+ * @param width width to right align the count to
  *
- * @return the number or hard links converted to a string
+ * @return bytes written
  */
-std::string fileEnt::getRefCnt(int padding) const {
-  std::string padStr = "";
-  std::string refCnt = std::to_string(_stat.st_nlink);
-  if (padding > 0) {
-    return pad(padStr, padding - refCnt.length()) + refCnt;
-  } else {
-    return refCnt;
-  }
+size_t fileEnt::fmtRefCnt(char *buf, size_t width) const {
+  return fmtDecimal(buf, getNLink(), width);
 }
 
 /**
- * @brief get the path that a symlink points to
+ * @brief write the path that a symlink points to
  *
- * @return a string containing the path to the symlink target
+ * @param buf where to put the target
+ * @param size size of buf, longer targets are cut short
+ *
+ * @return bytes written, 0 if the target couldn't be read
  */
-std::string fileEnt::getTarget() const {
-  const size_t size = 1024;
-  char targBuf[size];
-  ssize_t len;
-  if((len = readlink(_path.c_str(), targBuf, size)) > 0) {
-    targBuf[len] = '\0';
-    return std::string(targBuf);
-  } else {
-    return "";
-  }
+size_t fileEnt::fmtTarget(char *buf, size_t size) const {
+  dirHandle::pinGuard dir(*getDir());
+  ssize_t len = readlinkat(dir.fd(), nameStr(), buf, size);
+  return len > 0 ? len : 0;
 }
 
 /**
- * @brief convert the timestamp to a human readable format
+ * @brief write the timestamp in the --time-style style
  *
- * @return human readable timestamp
+ * @param buf room for timeWidth bytes
+ *
+ * @return bytes written
  */
-std::string fileEnt::getTimestampStr() const {
-  char timeBuff[32];
-  time_t timeStamp = getStat().st_mtim.tv_sec; 
-  if((time(0) - timeStamp) < 60 * 60 * 24 * 365) {
-    // Print the time when under a year old
-    strftime(timeBuff, 32, "%b %d %R", localtime(&timeStamp));
-  } else {
-    // Print the year when over a year old
-    strftime(timeBuff, 32, "%b %d %Y ", localtime(&timeStamp));
-  }
-  return std::string(timeBuff);
+size_t fileEnt::fmtTimestamp(char *buf) const {
+  return timeRender.format(buf, getTime());
 }
 
-time_t fileEnt::getModTS() const {
-  return getStat().st_mtim.tv_sec;
+/**
+ * @brief get the timestamp selected with -u, -c or --time
+ *
+ * @return the selected timestamp with nanosecond precision
+ */
+struct statx_timestamp fileEnt::getTime() const {
+  struct statx_timestamp ts;
+  memset(&ts, 0, sizeof(ts));
+  needStat();
+  if (!_store->_timeSec.empty()) {
+    ts.tv_sec  = _store->_timeSec[_idx];
+    ts.tv_nsec = _store->_timeNsec[_idx];
+  }
+  return ts;
 }
-
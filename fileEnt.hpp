@@ -2,64 +2,116 @@
 #define FILEENT_HPP
 
 #include <unordered_map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <string.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include "format.hpp"
+#include "dirHandle.hpp"
+#include "entryStore.hpp"
+#include "timeFmt.hpp"
+#include "idResolver.hpp"
 
 class fileEnt {
+  public:
+    // Which timestamp is shown and sorted on
+    enum timeField : int {
+      modTime    = 0,     // last modification (default)
+      accessTime = 1,     // last access (-u)
+      changeTime = 2,     // last status change (-c)
+      birthTime  = 3      // creation, if the filesystem records it
+    };
+
+  private:
+    entryStore    *_store;        // store holding the entry's columns
+    uint32_t       _idx;          // the entry's index in the store
+
   private:
-    std::string    _path;         // Full file path a/b/c/d.ex
-    std::string    _name;         // File name d.ex
-    unsigned char  _type;         // dirent type
-    const fileFmt *_fmt;          // associated format struct
-    struct stat    _stat;         // file stats from stat syscall
-    size_t         _nSuffixIcons; // number of suffix icons
+    // Fields requested from statx, built from the active flags
+    static unsigned int statxMask;
+    // Timestamp used for display and sorting
+    static timeField    timeSel;
+    // Renders the timestamp column in the --time-style style
+    static timeFmt      timeRender;
 
   private:
-    // Cache for queried user names
-    static std::unordered_map<uid_t, std::string> userNames;
-    // Cache for queried group names
-    static std::unordered_map<gid_t, std::string> groupNames;
+    // Owner and group names, shared by every listing
+    static idResolver   ids;
 
   public: 
-    fileEnt(std::string dir, std::string name, unsigned char type = DT_UNKNOWN);
-    virtual ~fileEnt();
+    fileEnt(entryStore *store, uint32_t idx) : _store(store), _idx(idx) {}
 
     // Setters
     void setFmt(const fileFmt *fmt);
+    static void setStatxMask(unsigned int mask);
+    static void setTimeField(timeField field);
+    static bool setTimeStyle(const std::string & style);
+    static void setNumericIds(bool numeric);
+    static void setIdCache(time_t ttl);
+    static void resolveIds(std::vector<uint32_t> & uids, std::vector<uint32_t> & gids);
+
+    static timeField    getTimeField();
+    static unsigned int getStatxMask();
 
     // Direct member getters
           unsigned char getType() const;
-    const std::string & getColor()                    const;
-    const std::string & getPermColor()                const;
-    const std::string & getIcon()                     const;
-          std::string   getName()                     const;
+     std::string_view   getColor()                    const;
+     std::string_view   getPermColor()                const;
+     std::string_view   getIcon()                     const;
+     std::string_view   getName()                     const;
           std::string   getPath()                     const;
-    const size_t      & getNSuffixIcons()             const;
-          time_t        getModTS()                    const;
+    const std::shared_ptr<dirHandle> & getDir()       const;
+    std::shared_ptr<dirHandle> subdir()               const;
+          size_t        getWidth()                    const;
+          size_t        getSuffixWidth()              const;
+          mode_t        getFileMode()                 const;
+          uint32_t      getIndex()                    const;
+          mode_t        getMode()                     const;
+          uid_t         getUid()                      const;
+          gid_t         getGid()                      const;
+          nlink_t       getNLink()                    const;
           off_t         getSize()                     const;
+    struct statx_timestamp getTime()                  const;
+
+    // Long listing fields, written into the caller's buffer
+    static const size_t timeWidth = timeFmt::maxWidth;
+    static const size_t targetMax = 1023;
+          size_t        fmtPermissions(char *buf)     const;
+          size_t        fmtRefCnt(char *buf, size_t width) const;
+          size_t        fmtSize(char *buf)            const;
+          size_t        fmtTimestamp(char *buf)       const;
+          size_t        fmtTarget(char *buf, size_t size) const;
 
     // Other getters
           std::string   formatted(size_t length)      const;
-          std::string   getPermissionString()         const;
-          std::string & getOwnerName()                const;
-          std::string & getGroupName()                const;
-          std::string   getSizeStr()                  const;
-          std::string   getTimestampStr()             const;
-          std::string   getRefCnt(int padding = -1)   const;
-          std::string   getSuffixIcons()              const;
-          std::string   getTarget()                   const;
+    const std::string & getOwnerName()                const;
+    const std::string & getGroupName()                const;
+     std::string_view   getSuffixIcons()              const;
     const char        * getEmphasis()                 const;
     const char        * getLink()                     const;
     const fileType    * getFileType()                 const;
           bool          isLink()                      const;
           bool          isDir()                       const;
           bool          isVisible()                   const;
+          bool          hasStat()                     const;
+          void          statAt(int dirfd)             const;
 
   private:
+    void loadStat() const;
+    void resolveType() const;
 
   public:
 
+    // Scatters io_uring statx completions into the store
+    friend class statRing;
+
     #include "fileEnt.inl"
 };
 
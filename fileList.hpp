@@ -0,0 +1,107 @@
+#ifndef FILELIST_HPP
+#define FILELIST_HPP
+
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+#include "fileEnt.hpp"
+#include "entryStore.hpp"
+
+/**
+ * @brief an ordered listing of entries held in an entryStore
+ *
+ * Only the 32-bit entry indices are kept in the list, so sorting, filtering
+ * and copying a listing moves indices rather than whole entries. Copies
+ * share the store.
+ */
+class fileList {
+  private:
+    std::shared_ptr<entryStore> _store;  // columns of every entry
+    std::vector<uint32_t>       _order;  // listing order, indices into _store
+
+  public:
+    class iterator {
+      private:
+        const fileList *_list;
+        size_t          _pos;
+
+      public:
+        iterator(const fileList *list, size_t pos) : _list(list), _pos(pos) {}
+
+        fileEnt    operator*()                         const { return (*_list)[_pos]; }
+        iterator & operator++()                              { ++_pos; return *this; }
+        bool       operator==(const iterator & other)  const { return _pos == other._pos; }
+        bool       operator!=(const iterator & other)  const { return _pos != other._pos; }
+    };
+
+    fileList() : _store(std::make_shared<entryStore>(fileEnt::getStatxMask())) {}
+    fileList(const std::shared_ptr<entryStore> & store) : _store(store) {}
+
+    /**
+     * @brief append a new entry to the store and the listing
+     */
+    inline void add(const std::shared_ptr<dirHandle> & dir, const char *name, size_t nameLen,
+                    unsigned char type) {
+      _order.push_back(_store->add(dir, name, nameLen, type));
+    }
+
+    /**
+     * @brief append a copy of another list's entry to the store and listing
+     *
+     * @return the copy's index in the store
+     */
+    inline uint32_t copy(const fileList & from, size_t pos) {
+      _order.push_back(_store->copy(*from._store, from._order[pos]));
+      return _order.back();
+    }
+
+    /**
+     * @brief append a copy of another list's entry under a new directory
+     *        and name
+     */
+    inline void copy(const fileList & from, size_t pos, const std::shared_ptr<dirHandle> & dir,
+                     std::string_view name) {
+      _order.push_back(_store->copy(*from._store, from._order[pos], dir, name));
+    }
+
+    /**
+     * @brief append an entry packed by entryStore::pack()
+     */
+    inline void unpack(const std::shared_ptr<dirHandle> & dir, const char *rec) {
+      _order.push_back(_store->unpack(dir, rec));
+    }
+
+    /**
+     * @brief append an entry that is already in this list's store
+     */
+    inline void push_back(const fileEnt & f) { _order.push_back(f.getIndex()); }
+
+    /**
+     * @brief empty the listing, starting over with a fresh store
+     */
+    inline void clear() {
+      _store = std::make_shared<entryStore>(fileEnt::getStatxMask());
+      _order.clear();
+    }
+
+    /**
+     * @brief empty the listing, reusing the store's memory for the next
+     *        entries, only for lists that don't share their store
+     */
+    inline void reuse() {
+      _store->clear();
+      _order.clear();
+    }
+
+    inline fileEnt  operator[](size_t pos) const { return fileEnt(_store.get(), _order[pos]); }
+    inline size_t   size()                 const { return _order.size(); }
+    inline bool     empty()                const { return _order.empty(); }
+    inline iterator begin()                const { return iterator(this, 0); }
+    inline iterator end()                  const { return iterator(this, _order.size()); }
+
+    inline       std::vector<uint32_t>       & order()          { return _order; }
+    inline const std::shared_ptr<entryStore> & getStore() const { return _store; }
+};
+
+#endif /* FILELIST_HPP */
@@ -1,6 +1,8 @@
 #ifndef FORMAT_HPP
 #define FORMAT_HPP
 
+#include <string_view>
+
 #define ESC         "\033["
 #define COLOR_ESC(c) ESC"38;5;" c "m"
 
@@ -17,14 +19,14 @@
 #define INDIGO  "105"
 #define ORANGE  "216"
 
-const std::string RWX_PERM = COLOR_ESC(WHITE);
-const std::string W_PERM   = COLOR_ESC(YELLOW);
-const std::string RW_PERM  = COLOR_ESC(GREEN);
-const std::string R_PERM   = COLOR_ESC(BLUE);
-const std::string RX_PERM  = COLOR_ESC(PURPLE);
-const std::string X_PERM   = COLOR_ESC(RED);
-const std::string WX_PERM  = COLOR_ESC(ORANGE);
-const std::string NO_PERM  = COLOR_ESC(DKGREY);
+constexpr std::string_view RWX_PERM = COLOR_ESC(WHITE);
+constexpr std::string_view W_PERM   = COLOR_ESC(YELLOW);
+constexpr std::string_view RW_PERM  = COLOR_ESC(GREEN);
+constexpr std::string_view R_PERM   = COLOR_ESC(BLUE);
+constexpr std::string_view RX_PERM  = COLOR_ESC(PURPLE);
+constexpr std::string_view X_PERM   = COLOR_ESC(RED);
+constexpr std::string_view WX_PERM  = COLOR_ESC(ORANGE);
+constexpr std::string_view NO_PERM  = COLOR_ESC(DKGREY);
 
 // Generic
 #define FILE_C    COLOR_ESC(ORANGE)
@@ -82,7 +84,7 @@ struct format {
 */
 
 struct fileType /*: format*/ {
-  std::string typeName;
+  const char       *typeName;
   const fileType   *parent;
   /*
   const format * format;
@@ -91,24 +93,35 @@ struct fileType /*: format*/ {
 };
 
 struct fileFmt /*: format*/ {
-  std::string  name;
-  std::string  icon;
-  std::string  fmt;
+  std::string_view   name;
+  std::string_view   icon;
+  std::string_view   fmt;
   const fileType    *parent;
-  fileFmt(std::string name, std::string icon, std::string fmt, const fileType *parent) : name(name), icon(icon), fmt(fmt), parent(parent){};
+  constexpr fileFmt(std::string_view name, std::string_view icon, std::string_view fmt, const fileType *parent) : name(name), icon(icon), fmt(fmt), parent(parent){};
   /*
   const format * format;
   fileFmt(std::string name, std::string icon, std::string fmt, const fileType *parent) : format(icon, fmt), name(name), icon(icon), fmt(fmt), parent(parent){};
   */
 };
 
+// How a fileNameFmt's name is matched against the whole file name
+enum nameMatch : unsigned char {
+  exactName = 0,   // literal file name
+  regexName = 1,   // regex: . [] () | * + ? and \ escapes
+  globName  = 2    // shell glob: * ? and [] with ! negation
+};
+
 struct fileNameFmt : fileFmt {
-  bool reg;
-  fileNameFmt(std::string name, std::string icon, std::string fmt, const fileType *parent, bool reg) : fileFmt(name, icon, fmt, parent), reg(reg){};
+  nameMatch match;
+  constexpr fileNameFmt(std::string_view name, std::string_view icon, std::string_view fmt, const fileType *parent, nameMatch match) : fileFmt(name, icon, fmt, parent), match(match){};
 };
 
+// Entries that go in a table's perfect hash
+constexpr bool hashed(const fileFmt &)       { return true; }
+
 extern const std::string emphasis[];
 
+#include "perfectHash.hpp"
 #include "formatTab.hpp"
 
 #endif /* FORMAT_HPP */
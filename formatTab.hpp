@@ -2,21 +2,21 @@
 #define FORMATTAB_HPP
 
 /* fileType hiererchy */
-const fileType file =         {"file", NULL};
-  const fileType srcType =      {"src",     &file};
-    const fileType webDevType =   {"webdev", &srcType};
-  const fileType exeType =      {"exe",     &file};
-  const fileType txtType =      {"txt",     &file};
-  const fileType archiveType =  {"arch",    &file};
-  const fileType imgType =      {"img",     &file};
-  const fileType audioType =    {"audio",   &file};
-  const fileType compiledType = {"comp",    &file};
-  const fileType tmpType =      {"tmp",     &file};
-  const fileType rcType =       {"rc", &file};
-  const fileType dir =          {"dir", NULL};
+inline constexpr fileType file =         {"file", NULL};
+  inline constexpr fileType srcType =      {"src",     &file};
+    inline constexpr fileType webDevType =   {"webdev", &srcType};
+  inline constexpr fileType exeType =      {"exe",     &file};
+  inline constexpr fileType txtType =      {"txt",     &file};
+  inline constexpr fileType archiveType =  {"arch",    &file};
+  inline constexpr fileType imgType =      {"img",     &file};
+  inline constexpr fileType audioType =    {"audio",   &file};
+  inline constexpr fileType compiledType = {"comp",    &file};
+  inline constexpr fileType tmpType =      {"tmp",     &file};
+  inline constexpr fileType rcType =       {"rc", &file};
+  inline constexpr fileType dir =          {"dir", NULL};
 
 /* general format entries accessed by index from enum */
-const fileFmt generalFormat[] = {
+inline constexpr fileFmt generalFormat[] = {
   {":FILE",     "",      FILE_C    , &file},
   {":DIRECTORY","",      DIR_C     , &dir},
   {":DOTFILE",  "",      DOTFILE   , &file},
@@ -27,20 +27,20 @@ const fileFmt generalFormat[] = {
 };
 
 /* filename format entries must match full filename */
-const fileNameFmt nameFormat[] = {
-  {".git",      "",      TXT, &file, false},
-  {".gitignore","",      TXT, &file, false},
-  {"LICENSE",   "",      TXT, &file, false},
-  {"Makefile",  "",      TXT, &file, false},
-  {"README",    "",      TXT, &file, false},
-  {"license",   "",      TXT, &file, false},
-  {"readme",    "",      TXT, &file, false},
-  {"tags",      "",      TXT, &file, false},
-  {"\\..*rc",   "",      TXT, &rcType, true }
+inline constexpr fileNameFmt nameFormat[] = {
+  {".git",      "",      TXT, &file, exactName},
+  {".gitignore","",      TXT, &file, exactName},
+  {"LICENSE",   "",      TXT, &file, exactName},
+  {"Makefile",  "",      TXT, &file, exactName},
+  {"README",    "",      TXT, &file, exactName},
+  {"license",   "",      TXT, &file, exactName},
+  {"readme",    "",      TXT, &file, exactName},
+  {"tags",      "",      TXT, &file, exactName},
+  {"\\..*rc",   "",      TXT, &rcType, regexName}
 };
 
 /* extension format entries must only match the file extension */
-const fileFmt extFormat[] = {
+inline constexpr fileFmt extFormat[] = {
   {"",          "",      EXE,       &exeType},
   {"exe",       "",      EXE,       &exeType},
   {"out",       "",      EXE,       &exeType},
@@ -180,4 +180,8 @@ const fileFmt extFormat[] = {
   {"yml",       "",      SRC,       &srcType},
   {"zsh",       "",      SRC,       &srcType}
 };
+
+/* perfect hash over the extensions, built at compile time */
+inline constexpr auto extHash  = makePerfectHash<4096>(extFormat);
+
 #endif /* FORMATTAB_HPP */
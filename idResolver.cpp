@@ -0,0 +1,236 @@
+#include <fstream>
+#include <sstream>
+#include <mutex>
+#include <algorithm>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <pwd.h>
+#include <grp.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "idResolver.hpp"
+
+namespace {
+
+const char kindChars[] = {'u', 'g'};
+
+/**
+ * @brief ask the name service for the name of one ID
+ *
+ * @param name set to the name if the ID is known
+ *
+ * @return false if the ID has no entry
+ */
+bool nssName(idResolver::idKind kind, uint32_t id, std::string & name) {
+  long hint = sysconf(kind == idResolver::user ? _SC_GETPW_R_SIZE_MAX : _SC_GETGR_R_SIZE_MAX);
+  std::vector<char> buf(hint > 0 ? hint : 1024);
+  for (;;) {
+    int err;
+    const char *found = NULL;
+    if (kind == idResolver::user) {
+      struct passwd pw, *res = NULL;
+      err = getpwuid_r(id, &pw, buf.data(), buf.size(), &res);
+      found = res ? res->pw_name : NULL;
+    } else {
+      struct group gr, *res = NULL;
+      err = getgrgid_r(id, &gr, buf.data(), buf.size(), &res);
+      found = res ? res->gr_name : NULL;
+    }
+    if (err == ERANGE) {
+      buf.resize(buf.size() * 2);
+      continue;
+    }
+    if (found == NULL) {
+      return false;
+    }
+    name = found;
+    return true;
+  }
+}
+
+}
+
+/**
+ * @brief an empty resolver that looks names up, without a disk cache
+ */
+idResolver::idResolver() :
+  _numeric(false),
+  _ttl(defaultTtl),
+  _dirty(false)
+  {}
+
+/**
+ * @brief write out the disk cache if anything was looked up
+ */
+idResolver::~idResolver() {
+  if (!_cachePath.empty() && _dirty) {
+    saveCache();
+  }
+}
+
+/**
+ * @brief show every ID as a number, as with -n
+ *
+ * Drops any names already read from the disk cache, they aren't shown
+ */
+void idResolver::setNumeric(bool numeric) {
+  std::unique_lock<std::shared_mutex> guard(_lock);
+  _numeric = numeric;
+  for (int kind = user; kind <= group; ++kind) {
+    _names[kind].clear();
+    _resolved[kind].clear();
+  }
+  _dirty = false;
+}
+
+/**
+ * @brief keep resolved names on disk and reuse them until they are ttl old
+ *
+ * The cache lives in $XDG_CACHE_HOME, or ~/.cache, as lspp-ids. It only
+ * ever saves lookups, a cache that can't be read or written is ignored.
+ *
+ * @param ttl seconds a cached name is trusted for
+ */
+void idResolver::setCache(time_t ttl) {
+  const char *dir = getenv("XDG_CACHE_HOME");
+  std::string base;
+  if (dir != NULL && *dir != '\0') {
+    base = dir;
+  } else if ((dir = getenv("HOME")) != NULL && *dir != '\0') {
+    base = std::string(dir) + "/.cache";
+  } else {
+    return;
+  }
+  _cachePath = base + "/lspp-ids";
+  _ttl = ttl;
+  if (!_numeric) {
+    loadCache();
+  }
+}
+
+/**
+ * @brief read the names from the disk cache that are still within the TTL
+ *
+ * Each line is the kind (u or g), the ID, when it was looked up and the name
+ */
+void idResolver::loadCache() {
+  std::ifstream in(_cachePath);
+  time_t now = time(0);
+  std::string line;
+  std::unique_lock<std::shared_mutex> guard(_lock);
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    char kindChar;
+    uint32_t id;
+    long long when;
+    std::string name;
+    if (!(fields >> kindChar >> id >> when >> name)) {
+      continue;
+    }
+    const char *kind = std::find(kindChars, kindChars + 2, kindChar);
+    if (kind == kindChars + 2 || now - when > _ttl || when > now) {
+      continue;
+    }
+    _names[kind - kindChars].emplace(id, name);
+    _resolved[kind - kindChars].emplace(id, when);
+  }
+}
+
+/**
+ * @brief replace the disk cache with every name that was looked up
+ *
+ * Written to a temporary file first so concurrent listings never read half
+ * a cache
+ */
+void idResolver::saveCache() {
+  std::string tmpPath = _cachePath + "." + std::to_string(getpid());
+  mkdir(_cachePath.substr(0, _cachePath.rfind('/')).c_str(), 0700);
+  {
+    std::ofstream cache(tmpPath, std::ios::trunc);
+    std::shared_lock<std::shared_mutex> guard(_lock);
+    for (int kind = user; kind <= group; ++kind) {
+      for (const auto & elem : _resolved[kind]) {
+        cache << kindChars[kind] << ' ' << elem.first << ' ' << (long long) elem.second
+              << ' ' << _names[kind].at(elem.first) << '\n';
+      }
+    }
+    if (!cache) {
+      unlink(tmpPath.c_str());
+      return;
+    }
+  }
+  if (rename(tmpPath.c_str(), _cachePath.c_str()) != 0) {
+    unlink(tmpPath.c_str());
+  }
+}
+
+/**
+ * @brief add the name for id, looking it up unless -n was given
+ *
+ * Must be called with _lock held exclusively. An ID the name service
+ * doesn't know is named by its number.
+ *
+ * @return the stored name
+ */
+const std::string & idResolver::lookup(idKind kind, uint32_t id) {
+  auto it = _names[kind].find(id);
+  if (it != _names[kind].end()) {
+    return it->second;
+  }
+  std::string name;
+  if (!_numeric && nssName(kind, id, name)) {
+    // Names with white space can't be read back from the disk cache
+    if (name.find_first_of(" \t\n") == std::string::npos) {
+      _resolved[kind].emplace(id, time(0));
+      _dirty = true;
+    }
+  } else {
+    name = std::to_string(id);
+  }
+  return _names[kind].emplace(id, name).first->second;
+}
+
+/**
+ * @brief resolve every ID of a listing before any is printed
+ *
+ * @param kind whether ids are user or group IDs
+ * @param ids the IDs, left sorted with duplicates removed
+ */
+void idResolver::resolve(idKind kind, std::vector<uint32_t> & ids) {
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+  std::vector<uint32_t> missing;
+  {
+    std::shared_lock<std::shared_mutex> guard(_lock);
+    std::copy_if(ids.begin(), ids.end(), std::back_inserter(missing),
+                 [&](uint32_t id) { return _names[kind].count(id) == 0; });
+  }
+  if (missing.empty()) {
+    return;
+  }
+  std::unique_lock<std::shared_mutex> guard(_lock);
+  for (uint32_t id : missing) {
+    lookup(kind, id);
+  }
+}
+
+/**
+ * @brief get the name of an ID, resolving it on its own if it wasn't batched
+ *
+ * @return the name, or the ID as a number if it has none
+ */
+const std::string & idResolver::name(idKind kind, uint32_t id) {
+  {
+    std::shared_lock<std::shared_mutex> guard(_lock);
+    auto it = _names[kind].find(id);
+    if (it != _names[kind].end()) {
+      return it->second;
+    }
+  }
+  std::unique_lock<std::shared_mutex> guard(_lock);
+  return lookup(kind, id);
+}
@@ -0,0 +1,63 @@
+#ifndef IDRESOLVER_HPP
+#define IDRESOLVER_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @brief maps user and group IDs to names for the long listing
+ *
+ * A listing's distinct IDs are resolved together before it is printed, so
+ * the name service is asked once per ID rather than on the first miss of
+ * each, and IDs it doesn't know are shown as numbers instead of failing.
+ * Resolved names are never removed or moved, so references handed out stay
+ * valid and readers only take a shared lock.
+ *
+ * Resolved names can also be kept in a small file in the user's cache
+ * directory and reused until they are older than a TTL, which saves the
+ * lookups entirely on hosts where the name service is a network round trip.
+ */
+class idResolver {
+  public:
+    enum idKind : int {
+      user  = 0,
+      group = 1
+    };
+
+  private:
+    // Resolved names for each idKind
+    std::unordered_map<uint32_t, std::string> _names[2];
+    // When each name was looked up, for the disk cache
+    std::unordered_map<uint32_t, time_t>      _resolved[2];
+    mutable std::shared_mutex _lock;
+
+    bool        _numeric;     // show IDs as numbers, never look them up
+    std::string _cachePath;   // empty unless the disk cache is enabled
+    time_t      _ttl;
+    bool        _dirty;       // names were looked up since the cache was read
+
+  private:
+    const std::string & lookup(idKind kind, uint32_t id);
+    void loadCache();
+    void saveCache();
+
+  public:
+    static const time_t defaultTtl = 60 * 60;
+
+    idResolver();
+    ~idResolver();
+    idResolver(const idResolver &) = delete;
+    idResolver & operator=(const idResolver &) = delete;
+
+    void setNumeric(bool numeric);
+    void setCache(time_t ttl);
+
+    void resolve(idKind kind, std::vector<uint32_t> & ids);
+    const std::string & name(idKind kind, uint32_t id);
+};
+
+#endif /* IDRESOLVER_HPP */
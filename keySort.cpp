@@ -0,0 +1,430 @@
+#include <memory>
+
+#include <ctype.h>
+#include <string.h>
+
+#include "keySort.hpp"
+
+namespace {
+
+// Runs this short are sorted entirely in cache
+const size_t cacheRun = 1 << 15;
+
+// Runs this short are insertion sorted rather than counted
+const size_t smallRun = 16;
+
+/**
+ * @brief stable insertion sort on the keys, for runs too short to count
+ */
+void insertionSort(sortKey *keys, size_t n) {
+  for (size_t i = 1; i < n; ++i) {
+    sortKey k = keys[i];
+    size_t j = i;
+    for (; j > 0 && keys[j - 1].key > k.key; --j) {
+      keys[j] = keys[j - 1];
+    }
+    keys[j] = k;
+  }
+}
+
+/**
+ * @brief stable LSD radix sort on the low nBytes bytes of the keys
+ *
+ * The counts for every byte are gathered in one read, and a byte that is
+ * the same in every key is skipped
+ *
+ * @param keys the run to sort, also where the result ends up
+ * @param scratch room for n keys
+ */
+void lsdSort(sortKey *keys, sortKey *scratch, size_t n, unsigned nBytes) {
+  size_t counts[8][256] = {};
+  for (size_t i = 0; i < n; ++i) {
+    for (unsigned b = 0; b < nBytes; ++b) {
+      ++counts[b][(keys[i].key >> (8 * b)) & 0xff];
+    }
+  }
+
+  sortKey *src = keys;
+  sortKey *dst = scratch;
+  for (unsigned b = 0; b < nBytes; ++b) {
+    size_t *count = counts[b];
+    if (count[(src[0].key >> (8 * b)) & 0xff] == n) {
+      continue;
+    }
+    size_t pos = 0;
+    for (unsigned d = 0; d < 256; ++d) {
+      size_t c = count[d];
+      count[d] = pos;
+      pos += c;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      dst[count[(src[i].key >> (8 * b)) & 0xff]++] = src[i];
+    }
+    std::swap(src, dst);
+  }
+  if (src != keys) {
+    std::copy(src, src + n, keys);
+  }
+}
+
+/**
+ * @brief split on the top 8 bits that differ until runs fit in cache
+ *
+ * A full LSD sort of a large listing streams every key through memory once
+ * per byte. Splitting on the highest differing bits first leaves runs that
+ * the LSD passes can then sort without leaving the cache.
+ */
+void msdSort(sortKey *keys, sortKey *scratch, size_t n) {
+  if (n <= smallRun) {
+    insertionSort(keys, n);
+    return;
+  }
+  uint64_t diff = 0;
+  for (size_t i = 0; i < n; ++i) {
+    diff |= keys[i].key ^ keys[0].key;
+  }
+  if (diff == 0) {
+    return;
+  }
+  unsigned hi = 64 - __builtin_clzll(diff);
+  if (n <= cacheRun || hi <= 8) {
+    lsdSort(keys, scratch, n, (hi + 7) / 8);
+    return;
+  }
+
+  unsigned shift = hi - 8;
+  size_t start[257] = {};
+  for (size_t i = 0; i < n; ++i) {
+    ++start[((keys[i].key >> shift) & 0xff) + 1];
+  }
+  for (unsigned d = 0; d < 256; ++d) {
+    start[d + 1] += start[d];
+  }
+  size_t next[256];
+  std::copy(start, start + 256, next);
+  for (size_t i = 0; i < n; ++i) {
+    scratch[next[(keys[i].key >> shift) & 0xff]++] = keys[i];
+  }
+  std::copy(scratch, scratch + n, keys);
+
+  for (unsigned d = 0; d < 256; ++d) {
+    if (start[d + 1] - start[d] > 1) {
+      msdSort(keys + start[d], scratch + start[d], start[d + 1] - start[d]);
+    }
+  }
+}
+
+}
+
+/**
+ * @brief stable radix sort on the 64-bit keys
+ *
+ * Large inputs are split into cache sized runs on their top bits first,
+ * then each run, or a small input, is LSD sorted a byte at a time. Bytes
+ * that don't vary are skipped, so small sizes and timestamps close together
+ * take only a few passes.
+ *
+ * @param keys the keys to sort, ascending
+ */
+void radixSort(std::vector<sortKey> & keys) {
+  if (keys.size() < 2) {
+    return;
+  }
+  std::unique_ptr<sortKey[]> scratch(new sortKey[keys.size()]);
+  msdSort(keys.data(), scratch.get(), keys.size());
+}
+
+/**
+ * @brief stable radix sort of n keys using the caller's scratch space
+ *
+ * @param keys the keys to sort, ascending
+ * @param scratch room for n keys
+ */
+void radixSort(sortKey *keys, sortKey *scratch, size_t n) {
+  if (n > 1) {
+    msdSort(keys, scratch, n);
+  }
+}
+
+namespace {
+
+/**
+ * @brief find where the rank'th key of the merged parts falls in each part
+ *
+ * The largest key v with fewer than rank keys below it is searched for,
+ * the keys equal to v then make up the rest, taken from the earlier parts
+ * first as a stable merge would
+ *
+ * @param keys the sorted parts, back to back
+ * @param bound the start of each part and the end of the last
+ * @param split set to the position in each part
+ */
+void splitAtRank(const sortKey *keys, const std::vector<size_t> & bound,
+                 size_t rank, size_t *split) {
+  const size_t parts = bound.size() - 1;
+  auto below = [&](size_t p, uint64_t v) {
+    return (size_t) (std::lower_bound(keys + bound[p], keys + bound[p + 1], v,
+                                      [](const sortKey & k, uint64_t v) { return k.key < v; })
+                     - keys);
+  };
+  auto countBelow = [&](uint64_t v) {
+    size_t count = 0;
+    for (size_t p = 0; p < parts; ++p) {
+      count += below(p, v) - bound[p];
+    }
+    return count;
+  };
+
+  uint64_t lo = 0, hi = UINT64_MAX;
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo - 1) / 2 + 1;
+    if (countBelow(mid) <= rank) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+
+  size_t left = rank - countBelow(lo);
+  for (size_t p = 0; p < parts; ++p) {
+    size_t first = below(p, lo);
+    size_t equal = first;
+    while (equal < bound[p + 1] && equal - first < left && keys[equal].key == lo) {
+      ++equal;
+    }
+    left -= equal - first;
+    split[p] = equal;
+  }
+}
+
+/**
+ * @brief stable merge of the sorted ranges [from[p], to[p]) into out
+ *
+ * A heap holds the part each next key comes from, equal keys are taken
+ * from the earlier part first
+ */
+void mergeParts(const sortKey *keys, const size_t *from, const size_t *to,
+                size_t parts, sortKey *out) {
+  std::vector<size_t> pos(from, from + parts);
+  std::vector<uint32_t> heap;
+  auto after = [&](uint32_t x, uint32_t y) {
+    return keys[pos[x]].key > keys[pos[y]].key ||
+           (keys[pos[x]].key == keys[pos[y]].key && x > y);
+  };
+  for (uint32_t p = 0; p < parts; ++p) {
+    if (pos[p] < to[p]) {
+      heap.push_back(p);
+    }
+  }
+  std::make_heap(heap.begin(), heap.end(), after);
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), after);
+    uint32_t p = heap.back();
+    *out++ = keys[pos[p]++];
+    if (pos[p] < to[p]) {
+      std::push_heap(heap.begin(), heap.end(), after);
+    } else {
+      heap.pop_back();
+    }
+  }
+}
+
+}
+
+/**
+ * @brief stable radix sort on the 64-bit keys, shared between threads
+ *
+ * The keys are cut into one part per thread and each part is radix sorted
+ * on its own. The merged order is then cut into equal shares by rank, and
+ * each thread merges its share of every part. Ties keep their input order,
+ * so the result is exactly that of the single threaded sort.
+ *
+ * @param keys the keys to sort, ascending
+ * @param n the number of keys
+ * @param pool the threads to sort on
+ */
+void radixSort(sortKey *keys, size_t n, workerPool & pool) {
+  const size_t parts = std::min(pool.size(), n / parallelSortMin);
+  if (parts < 2) {
+    if (n > 1) {
+      std::unique_ptr<sortKey[]> scratch(new sortKey[n]);
+      msdSort(keys, scratch.get(), n);
+    }
+    return;
+  }
+
+  std::vector<size_t> bound(parts + 1);
+  for (size_t p = 0; p <= parts; ++p) {
+    bound[p] = n * p / parts;
+  }
+  std::unique_ptr<sortKey[]> scratch(new sortKey[n]);
+  pool.parallelFor(parts, 1, [&](size_t begin, size_t end) {
+    for (size_t p = begin; p < end; ++p) {
+      msdSort(keys + bound[p], scratch.get() + bound[p], bound[p + 1] - bound[p]);
+    }
+  });
+
+  // split[share * parts + p] is where the share starts in part p
+  std::vector<size_t> split((parts + 1) * parts);
+  for (size_t p = 0; p < parts; ++p) {
+    split[p] = bound[p];
+    split[parts * parts + p] = bound[p + 1];
+  }
+  pool.parallelFor(parts - 1, 1, [&](size_t begin, size_t end) {
+    for (size_t share = begin + 1; share < end + 1; ++share) {
+      splitAtRank(keys, bound, bound[share], &split[share * parts]);
+    }
+  });
+
+  pool.parallelFor(parts, 1, [&](size_t begin, size_t end) {
+    for (size_t share = begin; share < end; ++share) {
+      mergeParts(keys, &split[share * parts], &split[(share + 1) * parts],
+                 parts, scratch.get() + bound[share]);
+    }
+  });
+  pool.parallelFor(parts, 1, [&](size_t begin, size_t end) {
+    std::copy(scratch.get() + bound[begin], scratch.get() + bound[end], keys + bound[begin]);
+  });
+}
+
+/**
+ * @brief stable radix sort on the 64-bit keys, shared between threads
+ *
+ * @param keys the keys to sort, ascending
+ * @param pool the threads to sort on
+ */
+void radixSort(std::vector<sortKey> & keys, workerPool & pool) {
+  radixSort(keys.data(), keys.size(), pool);
+}
+
+/**
+ * @brief the first 8 bytes of str as a big endian number
+ *
+ * Comparing the numbers compares the prefixes as unsigned bytes, with
+ * shorter strings first
+ *
+ * @param foldCase lower case the bytes, as strcasecmp compares them
+ */
+uint64_t prefixKey(std::string_view str, bool foldCase) {
+  uint64_t key = 0;
+  size_t len = std::min(str.size(), (size_t) 8);
+  for (size_t i = 0; i < len; ++i) {
+    unsigned char c = str[i];
+    key |= (uint64_t) (foldCase ? tolower(c) : c) << (56 - 8 * i);
+  }
+  return key;
+}
+
+namespace {
+
+/**
+ * @brief length of name with its file suffixes cut off
+ *
+ * Suffixes are a run of ".[A-Za-z~][A-Za-z0-9~]*" at the end of the name,
+ * a hidden file's name can be all suffix
+ */
+size_t versionPrefixLen(std::string_view name) {
+  for (size_t i = 0; ; ++i) {
+    size_t prefixLen = i;
+    while (i + 1 < name.size() && name[i] == '.' &&
+           (isalpha((unsigned char) name[i + 1]) || name[i + 1] == '~')) {
+      for (i += 2; i < name.size() && (isalnum((unsigned char) name[i]) || name[i] == '~'); ++i) {}
+    }
+    if (i >= name.size()) {
+      return prefixLen;
+    }
+  }
+}
+
+/**
+ * @brief append the bytes that order str as a version
+ *
+ * The text runs are written a byte per character in version order, a
+ * tilde before the end of the run, then letters, then everything else.
+ * Each run ends with the end of run byte and the number after it is
+ * written as its digit count then its digits, leading zeros dropped, so
+ * longer numbers come after shorter ones. A final end of run byte puts
+ * names that stop before a tilde after it and before anything else.
+ */
+void appendVersion(std::string_view str, std::string & out) {
+  const char tilde = 0x01;
+  const char endOfRun = 0x02;
+  const char other = 0x7b;
+
+  size_t i = 0;
+  while (i < str.size()) {
+    for (; i < str.size() && !isdigit((unsigned char) str[i]); ++i) {
+      unsigned char c = str[i];
+      if (c == '~') {
+        out += tilde;
+      } else if (isalpha(c)) {
+        out += (char) c;
+      } else {
+        out += other;
+        out += (char) c;
+      }
+    }
+    out += endOfRun;
+
+    while (i < str.size() && str[i] == '0') {
+      ++i;
+    }
+    size_t start = i;
+    for (; i < str.size() && isdigit((unsigned char) str[i]); ++i) {}
+    out += (char) std::min(i - start, (size_t) 0xff);
+    out.append(str.substr(start, i - start));
+  }
+  out += endOfRun;
+}
+
+}
+
+/**
+ * @brief append a key for name that compares, with memcmp, as ls -v sorts
+ *
+ * "." goes first, then "..", then the other hidden files and then the
+ * rest. Names are ordered on their version with file suffixes cut off,
+ * then in full where that ties. Keys are never a prefix of one another
+ * unless equal, so the two parts are simply written back to back.
+ *
+ * @param name the file name
+ * @param out the key is appended here
+ */
+void appendVersionKey(std::string_view name, std::string & out) {
+  if (name == ".") {
+    out += (char) 0;
+    return;
+  }
+  if (name == "..") {
+    out += (char) 1;
+    return;
+  }
+  out += (char) (!name.empty() && name[0] == '.' ? 2 : 3);
+
+  size_t prefixLen = versionPrefixLen(name);
+  appendVersion(name.substr(0, prefixLen), out);
+  if (prefixLen != name.size()) {
+    appendVersion(name, out);
+  }
+}
+
+/**
+ * @brief append the strxfrm key of name for the collation locale
+ *
+ * memcmp on the keys orders the names as strcoll would, without each
+ * comparison working through the locale's tables again
+ *
+ * @param name NUL terminated file name
+ * @param out the key is appended here, without its NUL
+ */
+void appendCollationKey(const char *name, std::string & out) {
+  size_t start = out.size();
+  size_t room  = 4 * strlen(name) + 16;
+  out.resize(start + room);
+  size_t len = strxfrm(&out[start], name, room);
+  if (len >= room) {
+    out.resize(start + len + 1);
+    strxfrm(&out[start], name, len + 1);
+  }
+  out.resize(start + len);
+}
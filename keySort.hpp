@@ -0,0 +1,203 @@
+#ifndef KEYSORT_HPP
+#define KEYSORT_HPP
+
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <stdint.h>
+
+#include "workerPool.hpp"
+
+/**
+ * @brief an entry index tagged with the fixed width key it sorts on
+ */
+struct sortKey {
+  uint64_t key;
+  uint32_t idx;
+};
+
+// Listings shorter than this per thread are sorted on one thread
+const size_t parallelSortMin = 1 << 17;
+
+void radixSort(sortKey *keys, sortKey *scratch, size_t n);
+void radixSort(std::vector<sortKey> & keys);
+void radixSort(std::vector<sortKey> & keys, workerPool & pool);
+void radixSort(sortKey *keys, size_t n, workerPool & pool);
+uint64_t prefixKey(std::string_view str, bool foldCase);
+void appendVersionKey(std::string_view name, std::string & out);
+void appendCollationKey(const char *name, std::string & out);
+
+// A run of keys whose strings agree on every byte before offset of string
+// level, and on all of the strings before it
+struct tieRun {
+  size_t   begin;
+  size_t   n;
+  unsigned level;
+  size_t   offset;
+};
+
+/**
+ * @brief call fn(start, n) for each run of more than one equal key
+ */
+template <typename Fn>
+void forEachTie(const sortKey *keys, size_t n, Fn fn) {
+  for (size_t start = 0; start < n; ) {
+    size_t stop = start + 1;
+    while (stop < n && keys[stop].key == keys[start].key) {
+      ++stop;
+    }
+    if (stop - start > 1) {
+      fn(start, stop - start);
+    }
+    start = stop;
+  }
+}
+
+/**
+ * @brief radix sort a run of equal keys on the next bytes of their strings
+ *
+ * The run is sorted on the next 8 bytes of the string it tied on, or of
+ * the entries' next string once theirs are all the same, and so on for
+ * the runs that still tie, until none are left or every string is used
+ * up. Entries that are equal throughout keep their order. Runs still to do
+ * are kept on a stack, as paths can share very long prefixes.
+ *
+ * @param keys the keys the run's begin is relative to
+ * @param run the run to sort
+ * @param scratch room for the run's keys
+ * @param keyOf keyOf(idx, level) is the level'th string entry idx sorts on
+ * @param levels the number of strings each entry sorts on
+ * @param foldCase compare the strings lower cased
+ * @param flip xor'd into every key, ~0 to sort descending
+ */
+template <typename KeyOf>
+void refineTies(sortKey *keys, tieRun run, sortKey *scratch, KeyOf & keyOf,
+                unsigned levels, bool foldCase, uint64_t flip) {
+  std::vector<tieRun> todo(1, run);
+  while (!todo.empty()) {
+    tieRun r = todo.back();
+    todo.pop_back();
+    sortKey *k = keys + r.begin;
+
+    // Go on to the next string once the run's are used up, which means
+    // they are all the same
+    for (; r.level < levels; ++r.level, r.offset = 0) {
+      size_t longest = 0;
+      for (size_t i = 0; i < r.n; ++i) {
+        longest = std::max(longest, keyOf(k[i].idx, r.level).size());
+      }
+      if (longest > r.offset) {
+        break;
+      }
+    }
+    if (r.level == levels) {
+      continue;
+    }
+
+    for (size_t i = 0; i < r.n; ++i) {
+      const std::string_view str = keyOf(k[i].idx, r.level);
+      k[i].key = prefixKey(str.substr(std::min(r.offset, str.size())), foldCase) ^ flip;
+    }
+    radixSort(k, scratch, r.n);
+
+    forEachTie(k, r.n, [&](size_t start, size_t n) {
+      todo.push_back(tieRun{r.begin + start, n, r.level, r.offset + 8});
+    });
+  }
+}
+
+/**
+ * @brief one step of refineTies() for a run worth sharing between threads
+ *
+ * The run's keys are loaded from the next bytes of their strings and the
+ * run is radix sorted, each on all of the threads
+ *
+ * @param run the run to sort, its level and offset are moved past strings
+ *        that are used up
+ *
+ * @return false if every string of the run is used up
+ */
+template <typename KeyOf>
+bool sortLargeRun(sortKey *keys, tieRun & run, KeyOf & keyOf, unsigned levels,
+                  bool foldCase, uint64_t flip, workerPool & pool) {
+  sortKey *k = keys + run.begin;
+  const size_t parts = pool.size();
+  std::vector<size_t> longest(parts);
+  for (; run.level < levels; ++run.level, run.offset = 0) {
+    pool.parallelFor(parts, 1, [&](size_t begin, size_t end) {
+      for (size_t p = begin; p < end; ++p) {
+        longest[p] = 0;
+        for (size_t i = run.n * p / parts; i < run.n * (p + 1) / parts; ++i) {
+          longest[p] = std::max(longest[p], keyOf(k[i].idx, run.level).size());
+        }
+      }
+    });
+    if (*std::max_element(longest.begin(), longest.end()) > run.offset) {
+      break;
+    }
+  }
+  if (run.level == levels) {
+    return false;
+  }
+
+  pool.parallelFor(run.n, parallelSortMin, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const std::string_view str = keyOf(k[i].idx, run.level);
+      k[i].key = prefixKey(str.substr(std::min(run.offset, str.size())), foldCase) ^ flip;
+    }
+  });
+  radixSort(k, run.n, pool);
+  return true;
+}
+
+/**
+ * @brief finish a sort on string prefixes by sorting each run of equal keys
+ *
+ * Entries sort on one or more strings compared bytewise one after the
+ * other, the keys hold the first 8 bytes of the first one. Each run of
+ * equal keys is radix sorted further on the following bytes, see
+ * refineTies(). Runs large enough for radixSort() to split are sorted on
+ * all the threads one after another, until what is left of them is small,
+ * and the small runs are then handed out whole. Either way the sort is
+ * stable, so the order is the same for any number of threads.
+ *
+ * @param keys sorted by key
+ * @param keyOf keyOf(idx, level) is the level'th string entry idx sorts on
+ * @param levels the number of strings each entry sorts on
+ * @param foldCase compare the strings lower cased, as strcasecmp does
+ * @param reverse the keys were flipped to sort descending
+ * @param pool threads to share the runs between
+ */
+template <typename KeyOf>
+void sortTies(std::vector<sortKey> & keys, KeyOf keyOf, unsigned levels, bool foldCase,
+              bool reverse, workerPool & pool) {
+  const uint64_t flip = reverse ? ~0ull : 0;
+  const size_t largeRun = pool.size() > 1 ? 2 * parallelSortMin : SIZE_MAX;
+  std::vector<tieRun> runs, large;
+  forEachTie(keys.data(), keys.size(), [&](size_t start, size_t n) {
+    (n >= largeRun ? large : runs).push_back(tieRun{start, n, 0, 8});
+  });
+
+  while (!large.empty()) {
+    tieRun r = large.back();
+    large.pop_back();
+    if (!sortLargeRun(keys.data(), r, keyOf, levels, foldCase, flip, pool)) {
+      continue;
+    }
+    forEachTie(keys.data() + r.begin, r.n, [&](size_t start, size_t n) {
+      (n >= largeRun ? large : runs).push_back(tieRun{r.begin + start, n, r.level, r.offset + 8});
+    });
+  }
+
+  // Most runs are a handful of keys, they go out in batches
+  pool.parallelFor(runs.size(), 64, [&](size_t begin, size_t end) {
+    std::vector<sortKey> scratch;
+    for (size_t r = begin; r < end; ++r) {
+      scratch.resize(std::max(scratch.size(), runs[r].n));
+      refineTies(keys.data(), runs[r], scratch.data(), keyOf, levels, foldCase, flip);
+    }
+  });
+}
+
+#endif /* KEYSORT_HPP */
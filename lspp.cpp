@@ -4,7 +4,6 @@
 #include <map>
 #include <algorithm>
 #include <sstream>
-#include <regex>
 #include <chrono>
 #include <functional>
 
@@ -15,12 +14,25 @@
 #include <getopt.h>
 #include <dirent.h>
 #include <assert.h>
+#include <errno.h>
 
 #include <time.h>
+#include <locale.h>
+#include <string.h>
 
 #include "lspp.hpp"
 #include "format.hpp"
 #include "fileEnt.hpp"
+#include "dirReader.hpp"
+#include "workerPool.hpp"
+#include "statRing.hpp"
+#include "traversal.hpp"
+#include "fieldFmt.hpp"
+#include "columnLayout.hpp"
+#include "keySort.hpp"
+#include "topList.hpp"
+#include "spillRuns.hpp"
+#include "nameMatcher.hpp"
 #include "usage.hpp"
 
 #include <stdio.h>
@@ -29,34 +41,18 @@
  * @brief perform format lookup by filename
  *
  * @param f file entry to look up
+ * @param name file's name without any leading directories
  *
  * @return true if the format was set
  */
-bool lookupByFilename(fileEnt & f) {
-  static std::unordered_map<const fileNameFmt *, std::regex> regMap;
-  std::string name = f.getName(); 
-  for(std::size_t i = 0; i < sizeof(nameFormat)/sizeof(*nameFormat); i++) {
-    const fileNameFmt * entry = &nameFormat[i];
-    if (entry->reg) {
-      // Handle if the filename format is a regex
-      std::regex re;
-
-      // Use a cache to avoid recomputing regexes
-      auto it = regMap.find(entry);
-      if (it == regMap.end()) {
-        regMap[&nameFormat[i]] = std::regex(entry->name);
-      }
-      if(regex_match(name, regMap[&nameFormat[i]])) {
-        f.setFmt(entry);
-        return true;
-      }
-    } else {
-      // Handle if the filename format is simple string
-      if (name == entry->name) {
-        f.setFmt(entry);
-        return true;
-      }
-    }
+bool lookupByFilename(fileEnt & f, std::string_view name) {
+  // Every name pattern compiled into one automaton on first use
+  static const nameMatcher matcher(nameFormat, sizeof(nameFormat)/sizeof(*nameFormat));
+
+  const fileNameFmt * entry = matcher.match(name);
+  if (entry != NULL) {
+    f.setFmt(entry);
+    return true;
   }
   return false;
 }
@@ -70,26 +66,15 @@ bool lookupByFilename(fileEnt & f) {
  *
  * @return true if the format was set
  */
-bool lookupByExtension(fileEnt & f, std::string baseName, std::string extension) {
-  static std::unordered_map<std::string, const fileFmt *> extCache;
-  // First try to find extension in cache
-  auto it = extCache.find(extension);
-  if (it != extCache.end()) {
-    f.setFmt(it->second);
+bool lookupByExtension(fileEnt & f, std::string_view baseName, std::string_view extension) {
+  // Find file extension with a single probe of the compile time hash
+  const fileFmt * entry = extHash.find(extension);
+  if (entry != NULL) {
+    f.setFmt(entry);
     return true;
-  } else {
-    // Find file extension
-    for(std::size_t i = 0; i < sizeof(extFormat)/sizeof(*extFormat); i++) {
-      const fileFmt * entry = &extFormat[i];
-      if (extension == entry->name) {
-        f.setFmt(entry);
-        extCache[extension] = &extFormat[i];
-        return true;
-      }
-    }
   }
 
-  if (baseName[0] == '.') {
+  if (!baseName.empty() && baseName[0] == '.') {
     // Check if file is a dotfile
     f.setFmt(&generalFormat[dotfileIndex]);
     return true;
@@ -97,130 +82,73 @@ bool lookupByExtension(fileEnt & f, std::string baseName, std::string extension)
 
   // Use the default if extension not found
   f.setFmt(&generalFormat[fileIndex]);
-  extCache[extension] = &generalFormat[fileIndex];
   return true;
 }
 
-/**
- * @brief check if files can be fit in witdh columns on the terminal
- *
- * @param filenames the list of files to pack
- * @param width the width of the terminal
- * @param rows the number of rows to try and pack into
- * @param colWidths a vector of each column (of files) width
- *
- * @return true if the files can be fit in rows rows
- */
-static inline bool fitsInNRows(
-    std::vector<fileEnt> & filenames, 
-    unsigned short width, 
-    size_t rows,
-    std::vector<size_t> & colWidths
-    ) 
-{
-  const size_t padding = 4;
-  unsigned short totalSize = 0;
-  size_t colWidth;
-  size_t suffixLen;
-  for (size_t col = 0; col < (filenames.size() + rows - 1) / rows; ++col) {
-    colWidth = 0;
-    for (size_t row = 0; row < rows; ++row) {
-      if (col * rows + row + 1 > filenames.size()) { 
-        break; 
-      }
-      fileEnt & ent = filenames[col * rows + row];
-      suffixLen = ent.getNSuffixIcons() > 0 ? 2 * ent.getNSuffixIcons() : 0;
-      colWidth = std::max(colWidth, ent.getName().length() + suffixLen + padding);
-    }
-    colWidths.push_back(colWidth);
-    totalSize += colWidth;
-  }
-  return totalSize <= width;
-}
+void printByType(fileList & filenames) {
+  std::map<const std::string, fileList> typeMap;
 
-void printByType(std::vector<fileEnt> & filenames) {
-  std::map<const std::string, std::vector<fileEnt> > typeMap;
-
-  // Generate list by types
+  // Generate list by types, each sharing the listing's store
   std::for_each(filenames.begin(), filenames.end(), 
-    [&typeMap](auto & f){
-      typeMap[f.getFileType()->typeName].push_back(f);});
+    [&typeMap, &filenames](const fileEnt & f){
+      typeMap.emplace(f.getFileType()->typeName, fileList(filenames.getStore()))
+        .first->second.push_back(f);});
 
   // Print by type
   for(auto & t : typeMap) {
-    std::cout << ESC "0m" << t.first << std::endl;
+    out.put(ESC "0m");
+    out.put(t.first);
+    out.put('\n');
     printFiles(t.second);
-    std::cout << std::endl;
+    out.put('\n');
   }
 }
 
-static void printFormatColumn(fileEnt & f, size_t length) {
-  std::string padding = "";
-  size_t suffixLen = f.getNSuffixIcons() > 0 ? 2 * f.getNSuffixIcons() : 0;
-  ssize_t padLen = length - f.getName().length() - suffixLen;
-  if (padLen >= 0) {
-    padding.resize(padLen, ' ');
-  }
+static void printFormatColumn(const fileEnt & f, size_t length) {
+  ssize_t padLen = length - f.getWidth() - f.getSuffixWidth();
   if (args.getFlag(argSet::flags::color)) {
     if (args.getFlag(argSet::flags::perm)) {
-      std::cout << f.getPermColor();
+      out.put(f.getPermColor());
     } else {
-      std::cout << f.getColor();
+      out.put(f.getColor());
     }
   }
   if (args.getFlag(argSet::flags::icon)) {
-    std::cout << f.getIcon() << " ";
+    out.put(f.getIcon());
+    out.put(' ');
+  }
+  out.put(f.getName());
+  out.put(f.getSuffixIcons());
+  if (padLen >= 0) {
+    out.putSpaces(padLen);
   }
-  std::cout << f.getName() << f.getSuffixIcons() << padding;
 }
 
 /**
  * @brief print the list of file entries in right sized columns
  *
- * Binary seach for the number of rows needed to fit all of the files in
- * right sized columns and then print the files in their columns
+ * Find the fewest rows that fit all of the files in right sized columns
+ * and then print the files in their columns
  *
  * @param filenames list of file entries to print
  */
-void printColumns(std::vector<fileEnt> & filenames) {
-  std::vector<size_t> colWidths;
+void printColumns(fileList & filenames) {
+  const size_t padding = 4;
   struct winsize w;
   ioctl(0, TIOCGWINSZ, &w);
-  unsigned short width = w.ws_col;
-
-  // Get rough estimate of number of rows required
-  size_t rows = 1;
-  for(rows = 1;; rows *= 2) {
-    colWidths.clear();
-    if (fitsInNRows(filenames, width, rows, colWidths)) {
-      /* Kill loop without incrementing rows */
-      break;
-    }
-  }
-
-  // Binary search for the lowest number of columns that still can
-  // fit all of the files
-  size_t max = rows;
-  size_t min = std::max((size_t) 2, rows / 2);
-  size_t test = max;
-  bool   lastFail = false;
-  for(test = (max + min) / 2; max > min; test = (max + min) / 2, colWidths.clear()) {
-    if (fitsInNRows(filenames, width, test, colWidths)) {
-      max = test;
-      lastFail = false;
-    } else {
-      min = test + 1;
-      lastFail = true;
-    }
-  }
+  size_t width = w.ws_col;
 
-  rows = max;
-
-  // If the last search was a failure, then we must regenerate the column list
-  if (lastFail) {
-    colWidths.clear(); fitsInNRows(filenames, width, rows, colWidths);
+  // Measure every entry once, in terminal cells
+  std::vector<uint16_t> widths;
+  widths.reserve(filenames.size());
+  for (const fileEnt & f : filenames) {
+    widths.push_back(std::min(f.getWidth() + f.getSuffixWidth() + padding, (size_t) UINT16_MAX));
   }
 
+  columnLayout layout(std::move(widths));
+  size_t rows = layout.fit(width);
+  const std::vector<size_t> & colWidths = layout.colWidths();
+
   size_t maxCols = (filenames.size() + rows - 1) / rows;
   for (size_t row = 0; row < rows; ++row) {
     for (size_t col = 0; col < maxCols; ++col) {
@@ -233,123 +161,151 @@ void printColumns(std::vector<fileEnt> & filenames) {
           printFormatColumn(filenames[col * rows + row], 0);
         }
     }
-    std::cout << std::endl;
+    out.put('\n');
   }
 }
 
-const std::function<void(fileEnt & f)> printLongFormat(size_t linksMax) {
-  return [linksMax](auto & f) { 
+const std::function<void(const fileEnt & f)> printLongFormat(size_t linksMax) {
+  return [linksMax](const auto & f) { 
               if (!args.getFlag(argSet::flags::noFmt) &&
                   args.getFlag(argSet::flags::color)) {
-                std::cout << f.getEmphasis();
+                out.put(f.getEmphasis());
                 if (args.getFlag(argSet::flags::perm)) {
-                  std::cout << f.getPermColor();
+                  out.put(f.getPermColor());
                 } else {
-                  std::cout << f.getColor();
+                  out.put(f.getColor());
                 }
               }
-              std::cout << f.getPermissionString() << " ";
-              std::cout << f.getRefCnt(linksMax) << " ";
+              out.commit(f.fmtPermissions(out.reserve(modeWidth)));
+              out.put(' ');
+              out.commit(f.fmtRefCnt(out.reserve(std::max(linksMax, decimalMax)), linksMax));
+              out.put(' ');
               if (!args.getFlag(argSet::flags::noOwner)) {
-                std::cout << f.getOwnerName() << " ";
+                out.put(f.getOwnerName());
+                out.put(' ');
               }
               if (!args.getFlag(argSet::flags::noGroup)) {
-                std::cout << f.getGroupName() << " ";
+                out.put(f.getGroupName());
+                out.put(' ');
               }
               if (args.getFlag(argSet::flags::author)) {
-                std::cout << f.getOwnerName() << " ";
+                out.put(f.getOwnerName());
+                out.put(' ');
               }
-              std::cout << f.getSizeStr() << " ";
-              std::cout << f.getTimestampStr() << " ";
+              out.commit(f.fmtSize(out.reserve(sizeWidth)));
+              out.put(' ');
+              out.commit(f.fmtTimestamp(out.reserve(fileEnt::timeWidth)));
+              out.put(' ');
               if (args.getFlag(argSet::flags::icon)) {
-                std::cout << f.getIcon() << " ";
+                out.put(f.getIcon());
+                out.put(' ');
               }
-              std::cout << f.getName() << f.getSuffixIcons();
+              out.put(f.getName());
+              out.put(f.getSuffixIcons());
               if (f.isLink()) {
-                std::cout << " " << f.getTarget();
+                out.put(' ');
+                out.commit(f.fmtTarget(out.reserve(fileEnt::targetMax), fileEnt::targetMax));
               }
-              std::cout << std::endl; };
+              out.put('\n'); };
 }
 
 /**
- * @brief print a list of entries in long list format
+ * @brief print part of a long listing whose link count width is known
  *
  * @param filenames list of file entries to print
+ * @param linksMax width of the link count column over the whole listing
  */
-void printLongList(std::vector<fileEnt> & filenames) {
-  size_t userMax = 0, groupMax = 0, linksMax = 0;
-
-  // Find correct widths
-  for(fileEnt & f : filenames) {
-    userMax  = std::max(f.getOwnerName().length(), userMax);
-    groupMax = std::max(f.getGroupName().length(), groupMax);
-    linksMax = std::max(f.getRefCnt().length(), linksMax);
+void printLongPart(fileList & filenames, size_t linksMax) {
+  std::vector<uint32_t> uids, gids;
+  uids.reserve(filenames.size());
+  gids.reserve(filenames.size());
+  for (const fileEnt & f : filenames) {
+    uids.push_back(f.getUid());
+    gids.push_back(f.getGid());
   }
 
-  // Pad strings
-  fileEnt::padUserNames(userMax);
-  fileEnt::padGroupNames(groupMax);
+  // Look up every owner and group at once rather than on first use
+  fileEnt::resolveIds(uids, gids);
   //TODO pad size column (currently works up to a petabyte)
 
   // Print strings
-  for_each(filenames.begin(), filenames.end(), printLongFormat(linksMax));
+  std::for_each(filenames.begin(), filenames.end(), printLongFormat(linksMax));
+}
+
+/**
+ * @brief print a list of entries in long list format
+ *
+ * @param filenames list of file entries to print
+ */
+void printLongList(fileList & filenames) {
+  size_t linksMax = 0;
+
+  // Find correct widths
+  for(const fileEnt & f : filenames) {
+    linksMax = std::max(decimalWidth(f.getNLink()), linksMax);
+  }
+  printLongPart(filenames, linksMax);
 } 
 
 const std::function<void(fileEnt const &)> printShortFormat = 
            [](auto & f) { 
             if (args.getFlag(argSet::flags::color)) {
-              std::cout << f.getColor();
+              out.put(f.getColor());
             }
             if (args.getFlag(argSet::flags::icon)) {
-              std::cout << f.getIcon() << " ";
+              out.put(f.getIcon());
+              out.put(' ');
             }
-            std::cout << f.getName() << std::endl;};
+            out.put(f.getName());
+            out.put('\n');};
 
 /**
  * @brief simply print each file on its own line
  *
  * @param filenames the list of files to print
  */
-void printList(std::vector<fileEnt> & filenames) {
-  for_each(filenames.begin(), filenames.end(), printShortFormat);
+void printList(fileList & filenames) {
+  std::for_each(filenames.begin(), filenames.end(), printShortFormat);
 }
 
-void printTree(std::vector<fileEnt> & filenames) {
+void printTree(fileList & filenames) {
   // Keep track of if each directory traversed has more elements
   static std::vector<bool> indent = { true };
 
-  for (auto f = filenames.begin(); f != filenames.end(); f++) {
-    std::cout << DIR_C;
+  for (size_t i = 0; i < filenames.size(); i++) {
+    const fileEnt f = filenames[i];
+    const bool last = i == filenames.size() - 1;
+    out.put(DIR_C);
     for (auto b = indent.begin(); b != indent.end(); b++) {
       if (*b) { 
         if (b == indent.end() - 1) {
-          if (f == filenames.end() - 1) {
-            std::cout << "\u2514"; 
+          if (last) {
+            out.put("\u2514"); 
           } else {
-            std::cout << "\u251c"; 
+            out.put("\u251c"); 
           }
         } else {
-          std::cout << "\u2502"; 
+          out.put("\u2502"); 
         }
       } else { 
-        std::cout << " "; 
+        out.put(' '); 
       }
     }
     if (args.getFlag(argSet::flags::tree)) {
-      if (f->isDir()) {
-        std::cout << "\u252c";
+      if (f.isDir()) {
+        out.put("\u252c");
       } else {
-        std::cout << "\u2500";
+        out.put("\u2500");
       }
     }
-    printShortFormat(*f);
-    if (f->isDir()) {
-      if (f == filenames.end() - 1) {
+    printShortFormat(f);
+    if (f.isDir()) {
+      if (last) {
         indent.pop_back();
         indent.push_back(false);
       }
       indent.push_back(true);
-      listDirectory(f->getPath());
+      listDirectory(f.subdir());
       indent.pop_back();
     }
   }
@@ -363,9 +319,9 @@ void printTree(std::vector<fileEnt> & filenames) {
  *
  * @return true if the file or one of its ancestors is of type typeName
  */
-bool isChildType(const fileType * fType, std::string typeName) {
+bool isChildType(const fileType * fType, const std::string & typeName) {
   for(;fType != NULL; fType = fType->parent) {
-    if (!fType->typeName.compare(typeName)) {
+    if (typeName == fType->typeName) {
       return true;
     }
   }
@@ -387,6 +343,24 @@ extern int opterr = 0;
 
 std::string listType;
 
+/**
+ * @brief parse a size argument with an optional K, M or G binary suffix
+ *
+ * @param str the argument to parse
+ *
+ * @return the size in bytes, or 0 if the argument is malformed
+ */
+size_t parseSize(const char *str) {
+  char *end;
+  size_t size = strtoull(str, &end, 10);
+  switch (*end) {
+    case 'g': case 'G': size <<= 10; /* fallthrough */
+    case 'm': case 'M': size <<= 10; /* fallthrough */
+    case 'k': case 'K': size <<= 10; ++end; break;
+  }
+  return *end == '\0' ? size : 0;
+}
+
 /**
  * @brief Update the flagSet to match the provided flags and store any params
  *
@@ -403,7 +377,9 @@ void parseArgs(int argc, char * const * argv) {
   // start switch indices after ascii to avoid collisions
   enum longOptIndex : short {
     ft = 128, type = 129, author = 130, noFmt = 131, color = 132, 
-    icon = 133, tree = 134, help = 135, perm = 136};
+    icon = 133, tree = 134, help = 135, perm = 136, dirbuf = 137, time = 138,
+    jobs = 139, uring = 140, timeStyle = 141, idCache = 142, head = 143,
+    tail = 144, memLimit = 145, flat = 146};
   struct option longopts[] = {
     {"all",             0, NULL, 'a'    },
     {"allmost-aLl",     0, NULL, 'A'    },
@@ -418,11 +394,22 @@ void parseArgs(int argc, char * const * argv) {
     {"recursive",       0, NULL, 'R'    },
     {"tree",            0, NULL, tree   },
     {"perm",            0, NULL, perm   },
+    {"dirbuf",          1, NULL, dirbuf },
+    {"time",            1, NULL, time   },
+    {"time-style",      1, NULL, timeStyle },
+    {"numeric-uid-gid", 0, NULL, 'n'    },
+    {"id-cache",        2, NULL, idCache },
+    {"jobs",            1, NULL, jobs   },
+    {"uring",           0, NULL, uring  },
+    {"head",            1, NULL, head   },
+    {"tail",            1, NULL, tail   },
+    {"mem-limit",       1, NULL, memLimit },
+    {"flat",            0, NULL, flat   },
     {NULL,              0, NULL, 0      }
   };
 
   // parse the args
-  while((c = getopt_long(argc, argv, "aAglorRStUX1", longopts, &option_index)) != -1) {
+  while((c = getopt_long(argc, argv, "aAcglnorRStuUvX1", longopts, &option_index)) != -1) {
     switch (c) {
       // Handle long only args
       case ft:
@@ -465,32 +452,118 @@ void parseArgs(int argc, char * const * argv) {
           }
         }
         break;
+      case dirbuf:
+        if (parseSize(optarg) == 0) {
+          std::cerr << "lspp: invalid directory buffer size: " << optarg << std::endl;
+          exit(-1);
+        }
+        args.setDirBufSize(parseSize(optarg));
+        break;
+      case memLimit:
+        if (parseSize(optarg) == 0) {
+          std::cerr << "lspp: invalid memory limit: " << optarg << std::endl;
+          exit(-1);
+        }
+        args.setMemLimit(parseSize(optarg));
+        break;
+      case jobs:
+        {
+          int n = atoi(optarg);
+          if (n < 1) {
+            std::cerr << "lspp: invalid number of jobs: " << optarg << std::endl;
+            exit(-1);
+          }
+          args.setJobs(n);
+        }
+        break;
+      case head:
+      case tail:
+        {
+          char *end;
+          long n = strtol(optarg, &end, 10);
+          if (n < 0 || *optarg == '\0' || *end != '\0') {
+            std::cerr << "lspp: invalid number of entries: " << optarg << std::endl;
+            exit(-1);
+          }
+          args.setFlag(argSet::flags::head, c == head);
+          args.setFlag(argSet::flags::tail, c == tail);
+          args.setLimit(n);
+        }
+        break;
+      case time:
+        {
+          std::string timeArg = std::string(optarg);
+          if (!timeArg.compare("atime") || !timeArg.compare("access") ||
+              !timeArg.compare("use")) {
+            fileEnt::setTimeField(fileEnt::timeField::accessTime);
+          } else if (!timeArg.compare("ctime") || !timeArg.compare("status")) {
+            fileEnt::setTimeField(fileEnt::timeField::changeTime);
+          } else if (!timeArg.compare("birth") || !timeArg.compare("creation")) {
+            fileEnt::setTimeField(fileEnt::timeField::birthTime);
+          } else if (!timeArg.compare("mtime") || !timeArg.compare("modification")) {
+            fileEnt::setTimeField(fileEnt::timeField::modTime);
+          } else {
+            execvp("ls", argv);
+          }
+        }
+        break;
+      case timeStyle:
+        if (!fileEnt::setTimeStyle(std::string(optarg))) {
+          std::cerr << "lspp: invalid time style: " << optarg << std::endl;
+          exit(-1);
+        }
+        break;
+      case idCache:
+        {
+          long ttl = optarg == NULL ? idResolver::defaultTtl : atol(optarg);
+          if (ttl < 1) {
+            std::cerr << "lspp: invalid id cache ttl: " << optarg << std::endl;
+            exit(-1);
+          }
+          fileEnt::setIdCache(ttl);
+        }
+        break;
       case author:  args.setFlag(argSet::flags::author); break;
       case help:    args.setFlag(argSet::flags::help);   break;
       case noFmt:   args.setFlag(argSet::flags::noFmt);  break;
       case perm:    args.setFlag(argSet::flags::perm);   break;
       case type:    args.setFlag(argSet::flags::type);   break;
+      case uring:   args.setFlag(argSet::flags::uring);  break;
       case tree:    args.setFlag(argSet::flags::tree);   break;
+      case flat:    args.setFlag(argSet::flags::flat);   break;
 
       // Handle short args, argumnets with both a long and short argument
       // have their long argument routed to the same location as the short arg
       case 'a': args.setFlag(argSet::flags::all);        break;
       case 'A': args.setFlag(argSet::flags::almostAll);  break;
+      case 'c': fileEnt::setTimeField(fileEnt::timeField::changeTime); break;
       case 'g': args.setFlag(argSet::flags::noOwner);    break;
       //case 'h': args.setFlag(argSet::flags::help);       break;
       case 'l': args.setFlag(argSet::flags::longList);   break;
+      case 'n':
+        args.setFlag(argSet::flags::longList);
+        fileEnt::setNumericIds(true);
+        break;
       case 'o': args.setFlag(argSet::flags::noGroup);    break;
       case 'r': args.setFlag(argSet::flags::reverse);    break;
       case 'R': args.setFlag(argSet::flags::recursive);  break;
       case 'S': args.setFlag(argSet::flags::sortSize);   break;
       case 't': args.setFlag(argSet::flags::sortTime);   break;
+      case 'u': fileEnt::setTimeField(fileEnt::timeField::accessTime); break;
       case 'U': args.setFlag(argSet::flags::sortInDir);  break;
+      case 'v': args.setFlag(argSet::flags::sortVersion);break;
       case 'X': args.setFlag(argSet::flags::sortExt);    break;
       case '1': args.setFlag(argSet::flags::filePerLine);break;
       default:  execvp("ls", argv);
     }
   }
 
+  // A flat listing already takes in the whole tree
+  if (args.getFlag(argSet::flags::flat)) {
+    args.setFlag(argSet::flags::recursive, false);
+    args.setFlag(argSet::flags::tree, false);
+  }
+
   // Get directory to list or use "." if none provided
   if (optind < argc) {
     args.setLsDir(std::string(argv[optind]));
@@ -500,67 +573,317 @@ void parseArgs(int argc, char * const * argv) {
 }
 
 /**
- * @brief open dir and read in the list of files or the file is dir is a file
+ * @brief check if entries are printed in the long format, by -l, -g or -o
+ */
+static bool longFormat() {
+  return args.getFlag(argSet::flags::longList) ||
+         args.getFlag(argSet::flags::noGroup) ||
+         args.getFlag(argSet::flags::noOwner);
+}
+
+/**
+ * @brief work out if the active flags need any metadata beyond the dirent
  *
- * @param dir the directory to open, may be a regular file as well
- * @param filenames a list to populate with the filenames
+ * The name and d_type are enough for -1, --tree and plain listings, only the
+ * long format, permission coloring, size/time sorts and the visibility
+ * suffix icon of the columnar format need to stat every file
+ *
+ * @return true if every entry will need to be stat'd
  */
-void getFiles(const std::string lsdir, std::vector<fileEnt> & filenames) {
-  // Check if a directory or a file
-  struct stat stats;
-  if (stat(lsdir.c_str(), &stats) < 0) {
-    perror("stat: ");
-    exit(-1);
+static bool needsStat() {
+  if (longFormat()) {
+    return true;
+  }
+  if (!args.getFlag(argSet::flags::sortInDir) &&
+      (args.getFlag(argSet::flags::sortTime) || args.getFlag(argSet::flags::sortSize))) {
+    return true;
+  }
+  if (args.getFlag(argSet::flags::color) && args.getFlag(argSet::flags::perm)) {
+    return true;
   }
+  // Columns show the visibility suffix icon which needs the mode bits
+  return isatty(1) && !(args.getFlag(argSet::flags::filePerLine) ||
+                        args.getFlag(argSet::flags::tree));
+}
+
+/**
+ * @brief build the statx field mask for the active flags and sort key
+ *
+ * @return the STATX_* fields that the output will read
+ */
+static unsigned int statxMask() {
+  const unsigned int timeMasks[] = {STATX_MTIME, STATX_ATIME, STATX_CTIME, STATX_BTIME};
+  const unsigned int timeMask = timeMasks[fileEnt::getTimeField()];
+
+  // Type and mode pick the format, permission colors and suffix icons
+  unsigned int mask = STATX_TYPE | STATX_MODE;
+  if (longFormat()) {
+    mask |= STATX_NLINK | STATX_UID | STATX_GID | STATX_SIZE | timeMask;
+  }
+  if (args.getFlag(argSet::flags::color) && args.getFlag(argSet::flags::perm)) {
+    mask |= STATX_UID | STATX_GID;
+  }
+  if (args.getFlag(argSet::flags::sortTime)) {
+    mask |= timeMask;
+  }
+  if (args.getFlag(argSet::flags::sortSize)) {
+    mask |= STATX_SIZE;
+  }
+  return mask;
+}
 
-  if (S_ISDIR(stats.st_mode)) {
-    struct dirent * dent;
-    DIR * dir = opendir(lsdir.c_str());
-    if (dir == NULL) {
-      perror("opendir: ");
-      exit(-1);
+/**
+ * @brief the threads shared by the stat and sort passes, sized by --jobs
+ */
+workerPool & jobPool() {
+  static workerPool pool(args.getJobs());
+  return pool;
+}
+
+/**
+ * @brief stat every entry, through io_uring or spread over the worker pool
+ *
+ * With --uring the whole directory is submitted to the ring a batch at a
+ * time, falling back to the synchronous path if the kernel lacks io_uring.
+ * Otherwise each worker fills in the metadata of its own slice of the array.
+ * Either way the entries and their order are exactly the same as a serial
+ * pass.
+ *
+ * @param filenames the entries to stat
+ */
+void statFiles(fileList & filenames) {
+  // Small slices keep the workers balanced when some stats are slow
+  const size_t chunk = 64;
+  workerPool & pool = jobPool();
+
+  if (args.getFlag(argSet::flags::uring)) {
+    static statRing ring;
+    if (ring.ok() && ring.statAll(filenames)) {
+      return;
     }
+  }
 
-    // Read out all of the files
-    while((dent = readdir(dir))) {
-      if (dent->d_name[0] != '.' || 
-          args.getFlag(argSet::flags::all) || args.getFlag(argSet::flags::almostAll)) {
-        // Check for -A almost all
-        if (args.getFlag(argSet::flags::almostAll) && 
-           (!strcmp(dent->d_name, ".") || !strcmp(dent->d_name, ".."))) {
-          continue;
-        }
-        filenames.push_back(fileEnt(lsdir, dent->d_name, dent->d_type));
+  pool.parallelFor(filenames.size(), chunk, [&filenames](size_t begin, size_t end) {
+    // Entries of a directory are stat'd relative to its pinned descriptor
+    dirHandle::pinGuard dir(*filenames[begin].getDir());
+    for (size_t i = begin; i < end; ++i) {
+      if (filenames[i].getDir() == filenames[begin].getDir()) {
+        filenames[i].statAt(dir.fd());
+      } else {
+        filenames[i].needStat();
       }
     }
+  });
+}
+
+/**
+ * @brief check if a directory entry is shown under -a and -A
+ */
+static bool listed(const dirEntry & dent) {
+  if (dent.name[0] != '.') {
+    return true;
+  }
+  if (args.getFlag(argSet::flags::almostAll)) {
+    // Check for -A almost all
+    return strcmp(dent.name, ".") && strcmp(dent.name, "..");
+  }
+  return args.getFlag(argSet::flags::all);
+}
+
+/**
+ * @brief read the entries of an open directory, skipping hidden files
+ *
+ * Names are parsed in place from the getdents64 buffer so only the copy
+ * into the store's name buffer is made
+ *
+ * @param dir the open directory
+ * @param lsdir the directory's handle
+ * @param filenames a list to populate with the entries
+ */
+static void readEntries(dirReader & dir, const std::shared_ptr<dirHandle> & lsdir,
+                        fileList & filenames) {
+  dirEntry dent;
+  while(dir.next(dent)) {
+    if (listed(dent)) {
+      filenames.add(lsdir, dent.name, dent.nameLen, dent.type);
+    }
+  }
+}
+
+/**
+ * @brief read the entries of one getdents64 batch, skipping hidden files
+ *
+ * @param dir the open directory
+ * @param lsdir the directory's handle
+ * @param filenames a list to append the entries to
+ *
+ * @return false at the end of the directory or on error
+ */
+static bool readBatch(dirReader & dir, const std::shared_ptr<dirHandle> & lsdir,
+                      fileList & filenames) {
+  dirEntry dent;
+  if (!dir.next(dent)) {
+    return false;
+  }
+  do {
+    if (listed(dent)) {
+      filenames.add(lsdir, dent.name, dent.nameLen, dent.type);
+    }
+  } while (dir.buffered() && dir.next(dent));
+  return true;
+}
+
+/**
+ * @brief check if an entry is the . or .. listed by -a
+ */
+static bool isDotDir(const fileEnt & f) {
+  const std::string_view name = f.getName();
+  return name == "." || name == "..";
+}
+
+/**
+ * @brief read and stat a directory for the traversal read-ahead
+ *
+ * Errors are left for getFiles() to report once the listing is reached, so
+ * they show up in the same place as in a serial run
+ *
+ * @param lsdir the directory to read
+ * @param filenames a list to populate with the entries
+ * @param inWorker true on a read-ahead thread, which stats serially
+ *
+ * @return false if the directory couldn't be read
+ */
+static bool readAhead(const std::shared_ptr<dirHandle> & lsdir,
+                      fileList & filenames, bool inWorker) {
+  dirHandle::pinGuard pin(*lsdir);
+  dirReader dir(args.getDirBufSize());
+  if (pin.fd() < 0 || !dir.attach(pin.fd())) {
+    return false;
+  }
+  readEntries(dir, lsdir, filenames);
+  if (dir.error() != 0) {
+    filenames.clear();
+    return false;
+  }
+
+  if (needsStat()) {
+    if (inWorker) {
+      for (const fileEnt & f : filenames) {
+        f.statAt(pin.fd());
+      }
+    } else {
+      statFiles(filenames);
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief get the read-ahead engine for parallel -R and --tree walks
+ *
+ * Under --mem-limit the listings read ahead are held to the limit too.
+ *
+ * @return the engine, or NULL if the walk should stay serial
+ */
+static traversal * getTraversal() {
+  bool descends = args.getFlag(argSet::flags::recursive) ||
+                  args.getFlag(argSet::flags::flat) ||
+                  (args.getFlag(argSet::flags::tree) &&
+                   (!args.getFlag(argSet::flags::ft) || listType == "dir"));
+  if (args.getJobs() < 2 || !descends) {
+    return NULL;
+  }
+  static traversal walk(args.getJobs(), readAhead,
+                        [](const fileEnt & f) { return f.isDir() && !isDotDir(f); },
+                        args.getMemLimit() != 0 ? args.getMemLimit()
+                                                : traversal::defaultReadAhead);
+  return &walk;
+}
+
+/**
+ * @brief attach a reader to a pinned directory, exiting if it can't be read
+ *
+ * @param pin the directory's pin, held for as long as it is read
+ * @param dir the reader to attach, or NULL to only check for a directory
+ *
+ * @return false if the handle isn't a directory, and nothing was attached
+ */
+static bool openListing(const dirHandle::pinGuard & pin, dirReader * dir) {
+  if (pin.fd() < 0) {
+    if (errno == ENOTDIR) {
+      return false;
+    }
+    perror("opendir: ");
+    exit(-1);
+  }
+  if (dir != NULL && !dir->attach(pin.fd())) {
+    errno = dir->error();
+    perror("opendir: ");
+    exit(-1);
+  }
+  return true;
+}
+
+/**
+ * @brief exit if a directory couldn't be read to the end
+ */
+static void checkListing(const dirReader & dir) {
+  if (dir.error() != 0) {
+    errno = dir.error();
+    perror("getdents64: ");
+    exit(-1);
+  }
+}
+
+/**
+ * @brief open dir and read in the list of files or the file is dir is a file
+ *
+ * @param lsdir the directory to open, may be a regular file as well
+ * @param filenames a list to populate with the filenames
+ */
+void getFiles(const std::shared_ptr<dirHandle> & lsdir, fileList & filenames) {
+  // Check if a directory or a file
+  dirHandle::pinGuard pin(*lsdir);
+  dirReader dir(args.getDirBufSize());
+  if (openListing(pin, &dir)) {
+    readEntries(dir, lsdir, filenames);
+    checkListing(dir);
+
+    // Stat everything in one pass if the output needs it, otherwise entries
+    // are only stat'd on demand when their d_type isn't enough
+    if (needsStat()) {
+      statFiles(filenames);
+    }
     
   } else {
-    // TODO either need to read the directory above the file, or need
-    // to have a way to not need to use the dirent data
-    // currently lists the file and doesn't crash but metadata is garbage
+    // List the file on its own, stat'd relative to the directory above it
+    const std::string path = lsdir->getPath();
     std::string name, dir;
-    std::size_t index = lsdir.find_last_of("/");
+    std::size_t index = path.find_last_of("/");
     if (index == std::string::npos) {
-      name = lsdir;
+      name = path;
       dir = ".";
     } else {
-      dir = lsdir.substr(index);
-      name = lsdir.substr(index + 1);
+      dir = path.substr(0, index);
+      name = path.substr(index + 1);
     }
-    filenames.push_back(fileEnt(dir, name));
+    filenames.add(dirHandle::open(dir), name.c_str(), name.length(), DT_UNKNOWN);
   }
 }
 
-void getFormatStyle(std::vector<fileEnt> & filenames) {
+void getFormatStyle(fileList & filenames) {
   // Find the correct formatting settings
-  for(fileEnt & f : filenames) {
-    std::string name = f.getName();
-    std::string ext;
-    std::string base;
+  for(fileEnt f : filenames) {
+    std::string_view name = f.getName();
+    std::string_view ext;
+    std::string_view base;
+
+    // Entries of a --flat listing are named by their path
+    name.remove_prefix(name.find_last_of('/') + 1);
 
     // Extract basename and extension from the filename
     std::size_t index = name.find_last_of(".");
-    if (index == std::string::npos || index == 0) {
+    if (index == std::string_view::npos || index == 0) {
       base = name;
       ext = "";
     } else {
@@ -569,7 +892,7 @@ void getFormatStyle(std::vector<fileEnt> & filenames) {
     }
 
     // Look up the format to use for each file
-    switch(f.getStat().st_mode & S_IFMT) {
+    switch(f.getFileMode()) {
       case S_IFDIR:
         f.setFmt(&generalFormat[dirIndex]);
         break;
@@ -589,7 +912,7 @@ void getFormatStyle(std::vector<fileEnt> & filenames) {
         /* fallthrough */
       default:
         // Handle reserved Filenames
-        if (lookupByFilename(f)) break;
+        if (lookupByFilename(f, name)) break;
 
         // Handle files by extension
         if (lookupByExtension(f, base, ext)) break;
@@ -600,11 +923,80 @@ void getFormatStyle(std::vector<fileEnt> & filenames) {
   }
 }
 
-void filterFiles(std::vector<fileEnt> & filenames) {
-  auto it = remove_if(filenames.begin(), filenames.end(),
-    [](auto f)
-      { return !isChildType(f.getFileType(), listType); });
-  filenames.erase(it, filenames.end());
+void filterFiles(fileList & filenames) {
+  entryStore *store = filenames.getStore().get();
+  std::vector<uint32_t> & order = filenames.order();
+  auto it = remove_if(order.begin(), order.end(),
+    [store](uint32_t idx)
+      { return !isChildType(fileEnt(store, idx).getFileType(), listType); });
+  order.erase(it, order.end());
+}
+
+/**
+ * @brief look up the formats of a listing and apply --ft to it
+ */
+static void formatFiles(fileList & filenames) {
+  getFormatStyle(filenames);
+  if (args.getFlag(argSet::flags::ft)) { filterFiles(filenames); }
+}
+
+/**
+ * @brief get a batch just read from a directory ready to sort or print
+ *
+ * The batch is stat'd if the output needs it, formatted and filtered. With
+ * -R its subdirectories are kept first, as the batch's memory is reused.
+ *
+ * @param lsdir the directory the batch was read from
+ * @param batch the entries read
+ * @param subdirs the subdirectories are appended here for -R
+ * @param stat stat the entries whether or not the output needs it
+ */
+static void prepareBatch(const std::shared_ptr<dirHandle> & lsdir, fileList & batch,
+                         fileList & subdirs, bool stat = false) {
+  if (stat || needsStat()) {
+    statFiles(batch);
+  }
+  getFormatStyle(batch);
+  if (args.getFlag(argSet::flags::recursive)) {
+    for (const fileEnt & f : batch) {
+      if (f.isDir()) {
+        subdirs.add(lsdir, f.getName().data(), f.getName().size(), DT_DIR);
+      }
+    }
+  }
+  if (args.getFlag(argSet::flags::ft)) { filterFiles(batch); }
+}
+
+/**
+ * @brief check if names sort in the collation order of the user's locale
+ *
+ * The C and POSIX locales collate in byte order, names then keep the
+ * default case insensitive order
+ */
+bool collateNames() {
+  static const bool collate = [] {
+    const char *name = setlocale(LC_COLLATE, NULL);
+    return name != NULL && strcmp(name, "C") && strcmp(name, "POSIX") &&
+           strncmp(name, "C.", 2);
+  }();
+  return collate;
+}
+
+/**
+ * @brief find where an entry's extension starts for -X
+ *
+ * @param name the entry's name, or its path in a --flat listing
+ *
+ * @return the index past the last dot in the last path component, or the
+ *         name's length if there is none
+ */
+static size_t extensionStart(std::string_view name) {
+  const size_t dot   = name.find_last_of('.');
+  const size_t slash = name.find_last_of('/');
+  if (dot == std::string_view::npos || (slash != std::string_view::npos && dot < slash)) {
+    return name.size();
+  }
+  return dot + 1;
 }
 
 /**
@@ -612,50 +1004,155 @@ void filterFiles(std::vector<fileEnt> & filenames) {
  *
  * @param filenames the list of files to sort
  */
-void sortFiles(std::vector<fileEnt> & filenames) {
-  std::function<int(fileEnt const &, fileEnt const &)> sortBy;
-
+void sortFiles(fileList & filenames) {
   if (args.getFlag(argSet::flags::sortInDir)) {
     // Keep the files in the order they were in in the directory
     return;
-  } else if (args.getFlag(argSet::flags::sortTime)) {
-    // Sort by time
-    sortBy = [](auto const & x, auto const & y) {
-              return x.getModTS() < y.getModTS();};
+  }
+
+  // Only the listing's indices are moved, the entries stay put in the store.
+  // Each entry's key is taken once, -r inverts the keys rather than
+  // reversing the sorted order.
+  entryStore *store = filenames.getStore().get();
+  std::vector<uint32_t> & order = filenames.order();
+  const bool     reverse = args.getFlag(argSet::flags::reverse);
+  const uint64_t flip    = reverse ? ~0ull : 0;
+  // Large listings take their keys and are sorted on all of the --jobs
+  // threads, giving the same order as one thread would
+  workerPool & pool = jobPool();
+  std::vector<sortKey> keys(order.size());
+  auto setKeys = [&](auto keyOf) {
+                   pool.parallelFor(order.size(), parallelSortMin, [&](size_t begin, size_t end) {
+                     for (size_t i = begin; i < end; ++i) {
+                       keys[i] = sortKey{keyOf(fileEnt(store, order[i])) ^ flip, order[i]};
+                     }});};
+
+  if (args.getFlag(argSet::flags::sortTime)) {
+    // Sort by time, seconds and nanoseconds share a key unless the
+    // seconds span more than 34 bits, then nanoseconds are sorted first
+    int64_t minSec = INT64_MAX, maxSec = INT64_MIN;
+    for (uint32_t idx : order) {
+      int64_t sec = fileEnt(store, idx).getTime().tv_sec;
+      minSec = std::min(minSec, sec);
+      maxSec = std::max(maxSec, sec);
+    }
+    if (order.empty() || (uint64_t) maxSec - minSec < (1ull << 34)) {
+      setKeys([minSec](const fileEnt & f) {
+                const struct statx_timestamp & t = f.getTime();
+                return ((uint64_t) (t.tv_sec - minSec) << 30) | t.tv_nsec; });
+      radixSort(keys, pool);
+    } else {
+      setKeys([](const fileEnt & f) { return (uint64_t) f.getTime().tv_nsec; });
+      radixSort(keys, pool);
+      for (sortKey & k : keys) {
+        k.key = ((uint64_t) fileEnt(store, k.idx).getTime().tv_sec ^ (1ull << 63)) ^ flip;
+      }
+      radixSort(keys, pool);
+    }
 
   } else if (args.getFlag(argSet::flags::sortSize)) {
     // Sort by fileSize
-    sortBy = [](auto const & x, auto const & y) {
-              return x.getSize() < y.getSize();};
+    setKeys([](const fileEnt & f) { return (uint64_t) f.getSize(); });
+    radixSort(keys, pool);
 
   } else if (args.getFlag(argSet::flags::sortExt)) {
-    // Sort first by extension then by filename
-    sortBy = [](auto const & x, auto const & y) {
-              const std::string & xn = x.getName();
-              const std::string & yn = y.getName();
-
-              const size_t xpos = xn.find_last_of(".");
-              const std::string & xext = xpos != std::string::npos ? xn.substr(xpos + 1) : "";
-              const size_t ypos = yn.find_last_of(".");
-              const std::string & yext = ypos != std::string::npos ? yn.substr(ypos + 1) : "";
-
-              const int cmp = xext.compare(yext);
-              if (cmp == 0) { return xn.compare(yn) < 0; } 
-              else          { return cmp < 0; }};
+    // Sort first by extension then by filename, 8 bytes of them at a time
+    std::vector<uint32_t> extStart(store->size());
+    setKeys([&extStart](const fileEnt & f) {
+              const std::string_view name = f.getName();
+              extStart[f.getIndex()] = extensionStart(name);
+              return prefixKey(name.substr(extStart[f.getIndex()]), false); });
+    radixSort(keys, pool);
+    sortTies(keys, [store, &extStart](uint32_t idx, unsigned level) {
+              const std::string_view name = fileEnt(store, idx).getName();
+              return level == 0 ? name.substr(extStart[idx]) : name; },
+             2, false, reverse, pool);
+
+  } else if (args.getFlag(argSet::flags::sortVersion) || collateNames()) {
+    // Sort by version or in the locale's collation order, on a binary key
+    // built once per name and compared bytewise, the names themselves
+    // settle any ties
+    const bool version = args.getFlag(argSet::flags::sortVersion);
+    std::string keyBytes;
+    std::vector<size_t> keyStart(store->size());
+    std::vector<uint32_t> keyLen(store->size());
+    // The keys share one buffer, so they're built on this thread
+    for (size_t i = 0; i < order.size(); ++i) {
+      const std::string_view name = fileEnt(store, order[i]).getName();
+      const size_t start = keyBytes.size();
+      if (version) {
+        appendVersionKey(name, keyBytes);
+      } else {
+        // Names are NUL terminated in the store
+        appendCollationKey(name.data(), keyBytes);
+      }
+      keyStart[order[i]] = start;
+      keyLen[order[i]]   = keyBytes.size() - start;
+      keys[i] = sortKey{prefixKey(std::string_view(keyBytes).substr(start), false) ^ flip, order[i]};
+    }
+    radixSort(keys, pool);
+    sortTies(keys, [store, &keyBytes, &keyStart, &keyLen](uint32_t idx, unsigned level) {
+              return level == 0 ? std::string_view(keyBytes.data() + keyStart[idx], keyLen[idx])
+                                : fileEnt(store, idx).getName(); },
+             2, false, reverse, pool);
+
   } else {
-    // Sort by filename
-    sortBy = [](auto const & x, auto const & y) {
-              const char * xc = x.getName().c_str();
-              const char * yc = y.getName().c_str();
-              if (*xc == '.') ++xc;
-              if (*yc == '.') ++yc;
-              return strcasecmp(xc, yc) < 0;};
-  };
- 
-  if (args.getFlag(argSet::flags::reverse)) {
-    std::sort(filenames.rbegin(), filenames.rend(), sortBy);
+    // Sort by filename, ignoring case and a leading dot
+    auto sortName = [store](uint32_t idx, unsigned) {
+                      std::string_view name = fileEnt(store, idx).getName();
+                      if (!name.empty() && name[0] == '.') {
+                        name.remove_prefix(1);
+                      }
+                      return name; };
+    setKeys([&sortName](const fileEnt & f) {
+              return prefixKey(sortName(f.getIndex(), 0), true); });
+    radixSort(keys, pool);
+    sortTies(keys, sortName, 1, true, reverse, pool);
+  }
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    order[i] = keys[i].idx;
+  }
+}
+
+/**
+ * @brief build the keys that order entries across runs as sortFiles() does
+ *
+ * The key is compared first and the tie where keys are equal, both
+ * bytewise. -r is left to the merge, which reverses the pair.
+ *
+ * @param f the entry
+ * @param key set to the entry's sort key
+ * @param tie set to what settles entries with the same key
+ */
+static void mergeKey(const fileEnt & f, std::string & key, std::string & tie) {
+  auto putBigEndian = [&key](uint64_t n, unsigned bytes) {
+                        for (unsigned i = bytes; i-- > 0; ) {
+                          key += (char) (n >> (8 * i));
+                        }};
+  const std::string_view name = f.getName();
+
+  if (args.getFlag(argSet::flags::sortTime)) {
+    const struct statx_timestamp t = f.getTime();
+    putBigEndian((uint64_t) t.tv_sec ^ (1ull << 63), 8);
+    putBigEndian(t.tv_nsec, 4);
+  } else if (args.getFlag(argSet::flags::sortSize)) {
+    putBigEndian(f.getSize(), 8);
+  } else if (args.getFlag(argSet::flags::sortExt)) {
+    key.append(name.substr(extensionStart(name)));
+    tie.append(name);
+  } else if (args.getFlag(argSet::flags::sortVersion)) {
+    appendVersionKey(name, key);
+    tie.append(name);
+  } else if (collateNames()) {
+    appendCollationKey(name.data(), key);
+    tie.append(name);
   } else {
-    std::sort(filenames.begin(), filenames.end(), sortBy);
+    // Case folded, without a leading dot, as strcasecmp compares
+    const size_t start = !name.empty() && name[0] == '.' ? 1 : 0;
+    for (size_t i = start; i < name.size(); ++i) {
+      key += (char) tolower((unsigned char) name[i]);
+    }
   }
 }
 
@@ -664,10 +1161,8 @@ void sortFiles(std::vector<fileEnt> & filenames) {
  *
  * @param filenames the list of files to be printed
  */
-void printFiles(std::vector<fileEnt> & filenames) {
-  if (args.getFlag(argSet::flags::longList) || 
-      args.getFlag(argSet::flags::noGroup) || 
-      args.getFlag(argSet::flags::noOwner)) {
+void printFiles(fileList & filenames) {
+  if (longFormat()) {
     // Print in long list format
     printLongList(filenames);
   } else {
@@ -685,27 +1180,446 @@ void printFiles(std::vector<fileEnt> & filenames) {
   }
 }
 
-void listDirectory(std::string lsdir) {
-  std::vector<fileEnt>  filenames;
-  std::vector<fileEnt>  directories;
+/**
+ * @brief check if the listing can go out a getdents64 batch at a time
+ *
+ * Unsorted output of one name per line depends on nothing but the entry
+ * being printed, so no more than a batch of entries has to be held. The
+ * read-ahead of a parallel -R walk keeps whole directories instead.
+ */
+static bool streams() {
+  return args.getFlag(argSet::flags::sortInDir) &&
+         !longFormat() &&
+         !args.getFlag(argSet::flags::type) &&
+         !args.getFlag(argSet::flags::tree) &&
+         (!isatty(1) || args.getFlag(argSet::flags::filePerLine)) &&
+         !args.getFlag(argSet::flags::head) &&
+         !args.getFlag(argSet::flags::tail) &&
+         getTraversal() == NULL;
+}
+
+/**
+ * @brief list a directory as it is read, a getdents64 batch at a time
+ *
+ * Each batch is stat'd, formatted, printed and flushed before the next one
+ * is read into the same memory. With -R only the subdirectories are kept,
+ * to be listed after the directory as usual.
+ *
+ * @param lsdir the directory to list
+ *
+ * @return false if lsdir isn't a directory, and nothing was printed
+ */
+static bool streamDirectory(const std::shared_ptr<dirHandle> & lsdir) {
+  fileList subdirs;
+  {
+    // The directory is only held open while it is read
+    dirHandle::pinGuard pin(*lsdir);
+    dirReader dir(args.getDirBufSize());
+    if (!openListing(pin, &dir)) {
+      return false;
+    }
+
+    fileList batch;
+    while (readBatch(dir, lsdir, batch)) {
+      prepareBatch(lsdir, batch, subdirs);
+      printList(batch);
+
+      // Downstream readers get each batch as soon as it's listed
+      out.flush();
+      batch.reuse();
+    }
+    checkListing(dir);
+  }
+
+  std::for_each(subdirs.begin(), subdirs.end(),
+                [](const fileEnt & f) { listDirectory(f.subdir()); });
+  return true;
+}
+
+/**
+ * @brief check if listings past --mem-limit can be sorted on disk
+ *
+ * The merged runs come out a batch at a time, which suits output that
+ * goes line by line. Long listings only need their link count width,
+ * which is worked out as the entries are read.
+ */
+static bool spills() {
+  return args.getMemLimit() != 0 &&
+         !args.getFlag(argSet::flags::sortInDir) &&
+         !args.getFlag(argSet::flags::type) &&
+         !args.getFlag(argSet::flags::tree) &&
+         !args.getFlag(argSet::flags::head) &&
+         !args.getFlag(argSet::flags::tail) &&
+         (longFormat() || !isatty(1) || args.getFlag(argSet::flags::filePerLine));
+}
+
+// Sorting adds an order index, a key and the key's radix sort scratch to
+// each entry, on top of what the store holds
+static const size_t sortBytesPerEntry = sizeof(uint32_t) + 2 * sizeof(sortKey);
+
+// Entries merged from the runs and printed at once
+static const size_t mergeBatch = 1 << 12;
+
+/**
+ * @brief check if a listing has taken up --mem-limit, sorting included
+ */
+static bool fillsLimit(const fileList & batch) {
+  return batch.getStore()->bytes() + batch.size() * sortBytesPerEntry >= args.getMemLimit();
+}
+
+/**
+ * @brief widen the link count column of a spilled long listing for a batch
+ *
+ * @return the widest link count of linksMax and the batch's
+ */
+static size_t linksWidth(const fileList & batch, size_t linksMax) {
+  if (longFormat()) {
+    for (const fileEnt & f : batch) {
+      linksMax = std::max(decimalWidth(f.getNLink()), linksMax);
+    }
+  }
+  return linksMax;
+}
+
+/**
+ * @brief get the printer of the batches merged from spilled runs
+ *
+ * @param linksMax the widest link count of all the runs
+ */
+static std::function<void(fileList &)> printMerged(size_t linksMax) {
+  return [linksMax](fileList & merged) {
+    if (longFormat()) {
+      printLongPart(merged, linksMax);
+    } else {
+      printList(merged);
+    }
+  };
+}
+
+/**
+ * @brief list a directory within --mem-limit, spilling sorted runs to disk
+ *
+ * Entries are read until they take up the limit, then stat'd, formatted,
+ * filtered and sorted as usual and written out as a run, and the next
+ * entries start over in a fresh store. A directory that fits is printed
+ * straight away, otherwise the runs are merged and printed a batch at a
+ * time. With -R only the subdirectories are kept.
+ *
+ * @param lsdir the directory to list
+ *
+ * @return false if lsdir isn't a directory, and nothing was printed
+ */
+static bool spillDirectory(const std::shared_ptr<dirHandle> & lsdir) {
+  spillRuns runs(args.getFlag(argSet::flags::reverse), args.getMemLimit());
+  fileList batch;
+  fileList subdirs;
+  size_t linksMax = 0;
+  {
+    // The directory is only held open while it is read
+    dirHandle::pinGuard pin(*lsdir);
+    dirReader dir(args.getDirBufSize());
+    if (!openListing(pin, &dir)) {
+      return false;
+    }
+
+    bool more = true;
+    while (more) {
+      do {
+        more = readBatch(dir, lsdir, batch);
+      } while (more && !fillsLimit(batch));
+      checkListing(dir);
+
+      prepareBatch(lsdir, batch, subdirs);
+      sortFiles(batch);
+
+      if (!more && runs.size() == 0) {
+        // Everything fit
+        break;
+      }
+      linksMax = linksWidth(batch, linksMax);
+      if (!batch.empty()) {
+        runs.add(batch, mergeKey);
+      }
+      batch.clear();
+    }
+  }
+
+  if (runs.size() == 0) {
+    printFiles(batch);
+  } else {
+    runs.merge(lsdir, mergeBatch, printMerged(linksMax));
+  }
+  batch.reuse();
+
+  // Interactive output shows up a directory at a time, in step with errors
+  if (isatty(1)) {
+    out.flush();
+  }
+
+  std::for_each(subdirs.begin(), subdirs.end(),
+                [](const fileEnt & f) { listDirectory(f.subdir()); });
+  return true;
+}
+
+/**
+ * @brief check if --head or --tail can pick its entries as they are read
+ *
+ * Time and size orders rank every entry on numbers, so only the entries
+ * that make the cut are kept. Other orders sort the whole listing first.
+ */
+static bool selects() {
+  return (args.getFlag(argSet::flags::head) || args.getFlag(argSet::flags::tail)) &&
+         !args.getFlag(argSet::flags::sortInDir) &&
+         (args.getFlag(argSet::flags::sortTime) || args.getFlag(argSet::flags::sortSize)) &&
+         getTraversal() == NULL;
+}
+
+/**
+ * @brief offer each entry of a batch to the --head or --tail selection, on
+ *        its time or size
+ */
+static void rankEntries(topList & top, const fileList & batch) {
+  const bool byTime = args.getFlag(argSet::flags::sortTime);
+  for (size_t i = 0; i < batch.size(); ++i) {
+    const fileEnt f = batch[i];
+    if (byTime) {
+      const struct statx_timestamp t = f.getTime();
+      top.offer(batch, i, t.tv_sec, t.tv_nsec);
+    } else {
+      top.offer(batch, i, f.getSize(), 0);
+    }
+  }
+}
+
+/**
+ * @brief read a directory a batch at a time, keeping only the --head or
+ *        --tail entries of its time or size order
+ *
+ * @param lsdir the directory to list
+ * @param filenames set to the kept entries, formatted and in order
+ * @param directories set to every subdirectory, for -R
+ *
+ * @return false if lsdir isn't a directory, and nothing was read
+ */
+static bool selectDirectory(const std::shared_ptr<dirHandle> & lsdir,
+                            fileList & filenames, fileList & directories) {
+  dirHandle::pinGuard pin(*lsdir);
+  dirReader dir(args.getDirBufSize());
+  if (!openListing(pin, &dir)) {
+    return false;
+  }
+
+  topList top(args.getLimit(), args.getFlag(argSet::flags::tail),
+              args.getFlag(argSet::flags::reverse));
+  fileList batch;
+  while (readBatch(dir, lsdir, batch)) {
+    // The sort key needs the metadata whatever else is shown
+    prepareBatch(lsdir, batch, directories, true);
+    rankEntries(top, batch);
+    batch.reuse();
+  }
+  checkListing(dir);
+
+  filenames = top.take();
+  return true;
+}
+
+/**
+ * @brief cut a sorted listing down to its --head or --tail entries
+ */
+static void cutListing(fileList & filenames) {
+  std::vector<uint32_t> & order = filenames.order();
+  const size_t keep = std::min(args.getLimit(), order.size());
+  if (args.getFlag(argSet::flags::head)) {
+    order.resize(keep);
+  } else if (args.getFlag(argSet::flags::tail)) {
+    order.erase(order.begin(), order.end() - keep);
+  }
+}
+
+/**
+ * @brief append the entries below a directory to a --flat listing, depth
+ *        first
+ *
+ * Entries are copied, metadata and all, to the top directory of the walk
+ * under their path from it, so they sort and print as if they were all in
+ * the one directory. With --jobs the subdirectories are read ahead.
+ *
+ * @param top the directory being listed
+ * @param dir the directory to read
+ * @param prefix dir's path from top with a trailing slash, empty for top
+ * @param part the listing to append to
+ * @param added called with part after each directory is appended
+ */
+static void flattenDirectory(const std::shared_ptr<dirHandle> & top,
+                             const std::shared_ptr<dirHandle> & dir,
+                             const std::string & prefix, fileList & part,
+                             const std::function<void(fileList &)> & added) {
+  std::vector<std::pair<std::shared_ptr<dirHandle>, std::string> > subdirs;
+  {
+    fileList files;
+    traversal * walk = getTraversal();
+    if (walk == NULL || !walk->take(dir, files)) {
+      getFiles(dir, files);
+    }
+
+    std::string path(prefix);
+    for (size_t i = 0; i < files.size(); ++i) {
+      const fileEnt f = files[i];
+      if (isDotDir(f)) {
+        continue;
+      }
+      path.replace(prefix.size(), std::string::npos, f.getName());
+      part.copy(files, i, top, path);
+      if (f.isDir()) {
+        subdirs.emplace_back(f.subdir(), path + '/');
+      }
+    }
+  }
+  added(part);
+
+  for (const auto & sub : subdirs) {
+    flattenDirectory(top, sub.first, sub.second, part, added);
+  }
+}
+
+/**
+ * @brief list every entry below a directory as one listing of paths
+ *
+ * The whole tree is sorted, cut by --head or --tail and printed as a
+ * single directory would be. Time and size orders under --head or --tail
+ * only keep the entries that make the cut, unsorted lines go out a
+ * directory at a time, and past --mem-limit sorted runs are spilled to
+ * disk and merged, so only those hold less than the whole tree.
+ *
+ * @param lsdir the directory to list
+ *
+ * @return false if lsdir isn't a directory, and nothing was printed
+ */
+static bool flatDirectory(const std::shared_ptr<dirHandle> & lsdir) {
+  {
+    dirHandle::pinGuard pin(*lsdir);
+    if (!openListing(pin, NULL)) {
+      return false;
+    }
+  }
+
+  const bool cut = args.getFlag(argSet::flags::head) || args.getFlag(argSet::flags::tail);
+  const bool ranked = args.getFlag(argSet::flags::sortTime) ||
+                      args.getFlag(argSet::flags::sortSize);
+  const bool lines = !args.getFlag(argSet::flags::type) &&
+                     (!isatty(1) || args.getFlag(argSet::flags::filePerLine));
+
+  fileList filenames;
+  if (cut && ranked && !args.getFlag(argSet::flags::sortInDir)) {
+    // Each directory is ranked as it's read, keeping only the cut
+    topList top(args.getLimit(), args.getFlag(argSet::flags::tail),
+                args.getFlag(argSet::flags::reverse));
+    flattenDirectory(lsdir, lsdir, "", filenames, [&top](fileList & part) {
+      formatFiles(part);
+      rankEntries(top, part);
+      part.reuse();
+    });
+    filenames = top.take();
+
+  } else if (!cut && !longFormat() && lines && args.getFlag(argSet::flags::sortInDir)) {
+    // Unsorted lines are printed a directory at a time
+    flattenDirectory(lsdir, lsdir, "", filenames, [](fileList & part) {
+      formatFiles(part);
+      printList(part);
+      out.flush();
+      part.reuse();
+    });
+    return true;
+
+  } else if (spills()) {
+    // Sorted runs go to disk whenever the entries fill --mem-limit
+    spillRuns runs(args.getFlag(argSet::flags::reverse), args.getMemLimit());
+    size_t linksMax = 0;
+    auto spill = [&runs, &linksMax](fileList & part) {
+      formatFiles(part);
+      sortFiles(part);
+      linksMax = linksWidth(part, linksMax);
+      if (!part.empty()) {
+        runs.add(part, mergeKey);
+      }
+      part.clear();
+    };
+    flattenDirectory(lsdir, lsdir, "", filenames, [&spill](fileList & part) {
+      if (fillsLimit(part)) {
+        spill(part);
+      }
+    });
+
+    if (runs.size() != 0) {
+      spill(filenames);
+      runs.merge(lsdir, mergeBatch, printMerged(linksMax));
+      return true;
+    }
+    // Everything fit
+    formatFiles(filenames);
+    sortFiles(filenames);
+
+  } else {
+    flattenDirectory(lsdir, lsdir, "", filenames, [](fileList &) {});
+    formatFiles(filenames);
+    sortFiles(filenames);
+    cutListing(filenames);
+  }
+
+  if (args.getFlag(argSet::flags::type)) {
+    printByType(filenames);
+  } else {
+    printFiles(filenames);
+  }
+  return true;
+}
+
+void listDirectory(const std::shared_ptr<dirHandle> & lsdir) {
+  fileList  filenames;
+  fileList  directories;
 
   if (args.getFlag(argSet::flags::recursive)) {
-    std::cout << std::endl << "\033[0;m" << lsdir << ":" << std::endl;
+    out.put("\n\033[0;m");
+    out.put(lsdir->getPath());
+    out.put(":\n");
   }
 
-  // get all of the files in the directory
-  getFiles(lsdir, filenames);
+  // --flat lists the whole tree as one directory
+  if (args.getFlag(argSet::flags::flat) && flatDirectory(lsdir)) {
+    return;
+  }
 
-  // look up the correct format for each file
-  getFormatStyle(filenames);
+  // Unsorted lines are printed as the directory is read
+  if (streams() && streamDirectory(lsdir)) {
+    return;
+  }
+
+  // Listings past --mem-limit are sorted through runs on disk
+  if (spills() && spillDirectory(lsdir)) {
+    return;
+  }
 
-  directories = filenames;
+  // --head and --tail on time or size only keep the entries they list
+  if (!selects() || !selectDirectory(lsdir, filenames, directories)) {
+    // get all of the files in the directory, possibly already read ahead
+    traversal * walk = getTraversal();
+    if (walk == NULL || !walk->take(lsdir, filenames)) {
+      getFiles(lsdir, filenames);
+    }
 
-  // Filter the filenames to only files with the specified fileType
-  if (args.getFlag(argSet::flags::ft)) { filterFiles(filenames); }
+    // look up the correct format for each file
+    getFormatStyle(filenames);
 
-  // Sort the files
-  sortFiles(filenames);
+    directories = filenames;
+
+    // Filter the filenames to only files with the specified fileType
+    if (args.getFlag(argSet::flags::ft)) { filterFiles(filenames); }
+
+    // Sort the files
+    sortFiles(filenames);
+    cutListing(filenames);
+  }
 
   if (args.getFlag(argSet::flags::type)) { 
     // Print each typeType together either in long list or columnar format
@@ -715,18 +1629,23 @@ void listDirectory(std::string lsdir) {
     printFiles(filenames);
   }
 
+  // Interactive output shows up a directory at a time, in step with errors
+  if (isatty(1)) {
+    out.flush();
+  }
+
   // After listing the parent directory recursively list all child directories
   if (args.getFlag(argSet::flags::recursive)) {
-    for_each(directories.begin(), directories.end(),
-             [](fileEnt & f) { if (f.isDir()) listDirectory(f.getPath());});
+    std::for_each(directories.begin(), directories.end(),
+             [](const fileEnt & f) { if (f.isDir()) listDirectory(f.subdir());});
   }
 }
 
 int main(int argc, char **argv) {
   std::string           lsdir;
 
-  std::cout.sync_with_stdio(false);
-  std::setvbuf(stdout, NULL, _IOFBF, 8192);
+  // Names are collated in the user's locale
+  setlocale(LC_COLLATE, "");
 
   // Parse the command line flags and get the directory to list
   parseArgs(argc, argv);
@@ -734,6 +1653,9 @@ int main(int argc, char **argv) {
   // Print the usage message and exit if the help flag was set
   if (args.getFlag(argSet::flags::help)) { usage(); }
 
-  if (args.getFlag(argSet::flags::tree)) {std::cout << args.getLsDir() << std::endl;}
-  listDirectory(args.getLsDir());
+  // Only fetch the metadata that will actually be displayed or sorted on
+  fileEnt::setStatxMask(statxMask());
+
+  if (args.getFlag(argSet::flags::tree)) {out.put(args.getLsDir()); out.put('\n');}
+  listDirectory(dirHandle::open(args.getLsDir()));
 }
@@ -2,8 +2,13 @@
 #define LSPP_HPP
 
 #include <bitset>
+#include <string_view>
 
 #include "fileEnt.hpp"
+#include "fileList.hpp"
+#include "dirReader.hpp"
+#include "outWriter.hpp"
+#include "workerPool.hpp"
 
 class argSet {
   public: 
@@ -30,6 +35,11 @@ class argSet {
       recursive   = 18,     // recursively print subdirectories
       tree        = 19,     
       perm        = 20,     // color the files by the user's file permissions   
+      uring       = 21,     // stat through io_uring when the kernel supports it
+      sortVersion = 22,     // natural sort of version numbers in names
+      head        = 23,     // only list the first entries of each listing
+      tail        = 24,     // only list the last entries of each listing
+      flat        = 25,     // list the whole tree as one listing of paths
       nFlags      = 64
     };
 
@@ -37,6 +47,10 @@ class argSet {
   private: 
     std::bitset<nFlags> _flagBits;
     std::string         _lsdir;
+    size_t              _dirBufSize = dirReader::defaultBufSize;
+    unsigned            _jobs = 1;
+    size_t              _limit = 0;
+    size_t              _memLimit = 0;
 
   //methods
   private:
@@ -49,38 +63,48 @@ class argSet {
     // getters
     inline       bool          getFlag(flags flag) const { return _flagBits.test(flag); };
     inline const std::string & getLsDir()          const { return _lsdir; }
+    inline       size_t        getDirBufSize()     const { return _dirBufSize; }
+    inline       unsigned      getJobs()           const { return _jobs; }
+    inline       size_t        getLimit()          const { return _limit; }
+    inline       size_t        getMemLimit()       const { return _memLimit; }
 
     // setters
     inline void setFlag(flags flag, bool val = true) { _flagBits.set(flag, val); }
     inline void setLsDir(std::string lsdir)          { _lsdir = lsdir; }
-};
-
-class listTree {
-  fileEnt              node;
-  std::vector<fileEnt> children;
+    inline void setDirBufSize(size_t size)           { _dirBufSize = size; }
+    inline void setJobs(unsigned jobs)               { _jobs = jobs; }
+    inline void setLimit(size_t limit)               { _limit = limit; }
+    inline void setMemLimit(size_t limit)            { _memLimit = limit; }
 };
 
 argSet args;
+// All listing output goes through here, flushed on exit
+outWriter out;
 
 void usage();
 void parseArgs(int argc, char * const * argv);
-void getFiles(const std::string lsdir, std::vector<fileEnt> & filenames);
-void getFormatStyle(std::vector<fileEnt> & filenames);
-void fileterFiles(std::vector<fileEnt> & filenames);
-void sortFiles(std::vector<fileEnt> & filenames);
-void printFiles(std::vector<fileEnt> & filenames);
-void printByType(std::vector<fileEnt> & filenames);
+size_t parseSize(const char *str);
+void getFiles(const std::shared_ptr<dirHandle> & lsdir, fileList & filenames);
+void statFiles(fileList & filenames);
+void getFormatStyle(fileList & filenames);
+void fileterFiles(fileList & filenames);
+workerPool & jobPool();
+bool collateNames();
+void sortFiles(fileList & filenames);
+void printFiles(fileList & filenames);
+void printByType(fileList & filenames);
 
-void listDirectory(std::string lsdir);
+void listDirectory(const std::shared_ptr<dirHandle> & lsdir);
 
 // Helper functions for finding the file format and type
-bool lookupByFilename(fileEnt & f);
+bool lookupByFilename(fileEnt & f, std::string_view name);
 bool lookupByExtension(fileEnt & f);
 
 // Helper methods for printing
-void printColumns(std::vector<fileEnt> & filenames);
-void printLongList(fileEnt & f, unsigned char linkWidth);
-void printLongList(std::vector<fileEnt> & filenames);
-void printList(std::vector<fileEnt> & filenames);
+void printColumns(fileList & filenames);
+void printLongList(const fileEnt & f, unsigned char linkWidth);
+void printLongList(fileList & filenames);
+void printLongPart(fileList & filenames, size_t linksMax);
+void printList(fileList & filenames);
 
 #endif /* LSPP_HPP */
@@ -0,0 +1,376 @@
+#include <iostream>
+#include <map>
+#include <algorithm>
+
+#include "nameMatcher.hpp"
+
+/**
+ * @brief compile every name pattern of a table into one DFA
+ *
+ * @param table the name formats, matched in table order
+ * @param n number of entries in table
+ */
+nameMatcher::nameMatcher(const fileNameFmt *table, size_t n) :
+  _table(table),
+  _nClasses(0),
+  _start(deadState)
+  {
+    std::vector<int> starts;
+    for (size_t i = 0; i < n; ++i) {
+      std::string_view name = table[i].name;
+      parser p = {name.data(), name.data() + name.size(), name};
+      fragment f;
+      switch (table[i].match) {
+        case exactName:
+          f = literal(name);
+          break;
+        case regexName:
+          f = parseAlt(p);
+          if (p.pos != p.end) {
+            badPattern(p);
+          }
+          break;
+        case globName:
+          f = parseGlob(p);
+          break;
+        default:
+          badPattern(p);
+      }
+      _nfa[f.end].accept = i;
+      starts.push_back(f.start);
+    }
+
+    buildClasses();
+    buildDfa(starts);
+
+    // Only the DFA is needed from here on
+    _nfa.clear();
+    _nfa.shrink_to_fit();
+    _sets.clear();
+    _sets.shrink_to_fit();
+  }
+
+void nameMatcher::badPattern(const parser & p) {
+  std::cerr << "lspp: invalid name pattern: " << p.pattern << std::endl;
+  exit(-1);
+}
+
+int nameMatcher::newState() {
+  _nfa.push_back(nfaState{std::bitset<256>(), -1, std::vector<int>(), -1});
+  return _nfa.size() - 1;
+}
+
+/**
+ * @brief fragment matching a single byte from chars
+ */
+nameMatcher::fragment nameMatcher::byteSet(const std::bitset<256> & chars) {
+  int start = newState();
+  int end = newState();
+  _nfa[start].chars = chars;
+  _nfa[start].next = end;
+  _sets.push_back(chars);
+  return fragment{start, end};
+}
+
+nameMatcher::fragment nameMatcher::concat(fragment a, fragment b) {
+  _nfa[a.end].eps.push_back(b.start);
+  return fragment{a.start, b.end};
+}
+
+nameMatcher::fragment nameMatcher::alternate(fragment a, fragment b) {
+  int start = newState();
+  int end = newState();
+  _nfa[start].eps.push_back(a.start);
+  _nfa[start].eps.push_back(b.start);
+  _nfa[a.end].eps.push_back(end);
+  _nfa[b.end].eps.push_back(end);
+  return fragment{start, end};
+}
+
+/**
+ * @brief apply a * + or ? operator to a fragment
+ */
+nameMatcher::fragment nameMatcher::repeat(fragment a, char op) {
+  int start = newState();
+  int end = newState();
+  _nfa[start].eps.push_back(a.start);
+  _nfa[a.end].eps.push_back(end);
+  if (op == '*' || op == '?') {
+    _nfa[start].eps.push_back(end);
+  }
+  if (op == '*' || op == '+') {
+    _nfa[a.end].eps.push_back(a.start);
+  }
+  return fragment{start, end};
+}
+
+/**
+ * @brief fragment matching exactly name
+ */
+nameMatcher::fragment nameMatcher::literal(std::string_view name) {
+  int empty = newState();
+  fragment f = {empty, empty};
+  for (unsigned char c : name) {
+    std::bitset<256> chars;
+    chars.set(c);
+    f = concat(f, byteSet(chars));
+  }
+  return f;
+}
+
+/**
+ * @brief regex alternation, the lowest precedence operator
+ */
+nameMatcher::fragment nameMatcher::parseAlt(parser & p) {
+  fragment f = parseConcat(p);
+  while (p.pos != p.end && *p.pos == '|') {
+    ++p.pos;
+    f = alternate(f, parseConcat(p));
+  }
+  return f;
+}
+
+/**
+ * @brief a sequence of atoms, each optionally repeated
+ */
+nameMatcher::fragment nameMatcher::parseConcat(parser & p) {
+  int empty = newState();
+  fragment f = {empty, empty};
+  while (p.pos != p.end && *p.pos != '|' && *p.pos != ')') {
+    fragment atom = parseAtom(p);
+    while (p.pos != p.end && (*p.pos == '*' || *p.pos == '+' || *p.pos == '?')) {
+      atom = repeat(atom, *p.pos++);
+    }
+    f = concat(f, atom);
+  }
+  return f;
+}
+
+nameMatcher::fragment nameMatcher::parseAtom(parser & p) {
+  std::bitset<256> chars;
+  unsigned char c = *p.pos++;
+  switch (c) {
+    case '(': {
+      fragment f = parseAlt(p);
+      if (p.pos == p.end || *p.pos != ')') {
+        badPattern(p);
+      }
+      ++p.pos;
+      return f;
+    }
+    case '[':
+      return parseClass(p, '^');
+    case '.':
+      // Any byte but a line terminator, as with std::regex
+      chars.set();
+      chars.reset('\n');
+      chars.reset('\r');
+      return byteSet(chars);
+    case '\\':
+      if (p.pos == p.end) {
+        badPattern(p);
+      }
+      chars.set((unsigned char) *p.pos++);
+      return byteSet(chars);
+    case '*':
+    case '+':
+    case '?':
+      badPattern(p);
+    default:
+      chars.set(c);
+      return byteSet(chars);
+  }
+}
+
+/**
+ * @brief a bracket expression, the opening [ already consumed
+ *
+ * @param negate the character that negates the set when it comes first
+ */
+nameMatcher::fragment nameMatcher::parseClass(parser & p, char negate) {
+  std::bitset<256> chars;
+  bool negated = p.pos != p.end && *p.pos == negate;
+  if (negated) {
+    ++p.pos;
+  }
+
+  // A ] right after the opening bracket is a literal
+  bool first = true;
+  while (p.pos != p.end && (*p.pos != ']' || first)) {
+    first = false;
+    unsigned char lo = *p.pos++;
+    if (lo == '\\' && p.pos != p.end) {
+      lo = *p.pos++;
+    }
+    unsigned char hi = lo;
+    if (p.end - p.pos >= 2 && *p.pos == '-' && p.pos[1] != ']') {
+      ++p.pos;
+      hi = *p.pos++;
+      if (hi == '\\' && p.pos != p.end) {
+        hi = *p.pos++;
+      }
+    }
+    for (unsigned c = lo; c <= hi; ++c) {
+      chars.set(c);
+    }
+  }
+  if (p.pos == p.end) {
+    badPattern(p);
+  }
+  ++p.pos;
+
+  if (negated) {
+    chars.flip();
+  }
+  return byteSet(chars);
+}
+
+/**
+ * @brief a shell glob, which has no grouping so it is a flat sequence
+ */
+nameMatcher::fragment nameMatcher::parseGlob(parser & p) {
+  std::bitset<256> any;
+  any.set();
+
+  int empty = newState();
+  fragment f = {empty, empty};
+  while (p.pos != p.end) {
+    unsigned char c = *p.pos++;
+    std::bitset<256> chars;
+    switch (c) {
+      case '*':
+        f = concat(f, repeat(byteSet(any), '*'));
+        break;
+      case '?':
+        f = concat(f, byteSet(any));
+        break;
+      case '[':
+        f = concat(f, parseClass(p, '!'));
+        break;
+      case '\\':
+        if (p.pos == p.end) {
+          badPattern(p);
+        }
+        c = *p.pos++;
+        /* fallthrough */
+      default:
+        chars.set(c);
+        f = concat(f, byteSet(chars));
+    }
+  }
+  return f;
+}
+
+/**
+ * @brief extend a set of NFA states with everything reachable by epsilon moves
+ *
+ * @param set the states, left sorted
+ */
+void nameMatcher::closure(std::vector<int> & set) const {
+  std::vector<bool> seen(_nfa.size(), false);
+  std::vector<int>  stack(set);
+  set.clear();
+  while (!stack.empty()) {
+    int s = stack.back();
+    stack.pop_back();
+    if (seen[s]) {
+      continue;
+    }
+    seen[s] = true;
+    set.push_back(s);
+    for (int t : _nfa[s].eps) {
+      stack.push_back(t);
+    }
+  }
+  std::sort(set.begin(), set.end());
+}
+
+/**
+ * @brief group bytes that every byte set treats the same way
+ *
+ * Keeps the DFA rows to a handful of columns instead of 256
+ */
+void nameMatcher::buildClasses() {
+  std::map<std::vector<bool>, uint8_t> classes;
+  for (unsigned c = 0; c < 256; ++c) {
+    std::vector<bool> signature;
+    for (const std::bitset<256> & chars : _sets) {
+      signature.push_back(chars.test(c));
+    }
+    auto it = classes.emplace(signature, classes.size()).first;
+    _class[c] = it->second;
+  }
+  _nClasses = classes.size();
+}
+
+/**
+ * @brief subset construction, state 0 is the dead state
+ *
+ * @param starts the start state of each pattern
+ */
+void nameMatcher::buildDfa(const std::vector<int> & starts) {
+  std::map<std::vector<int>, uint16_t> ids;
+  std::vector<std::vector<int> > sets;
+  auto intern = [&](const std::vector<int> & set) {
+    auto it = ids.find(set);
+    if (it != ids.end()) {
+      return it->second;
+    }
+    uint16_t id = sets.size();
+    ids.emplace(set, id);
+    sets.push_back(set);
+    return id;
+  };
+
+  // A byte standing in for each class
+  std::vector<unsigned char> classByte(_nClasses);
+  for (unsigned c = 0; c < 256; ++c) {
+    classByte[_class[c]] = c;
+  }
+
+  intern(std::vector<int>());
+  std::vector<int> initial(starts);
+  closure(initial);
+  _start = intern(initial);
+
+  for (size_t i = 0; i < sets.size(); ++i) {
+    const std::vector<int> set = sets[i];
+
+    int accept = -1;
+    for (int s : set) {
+      if (_nfa[s].accept >= 0 && (accept < 0 || _nfa[s].accept < accept)) {
+        accept = _nfa[s].accept;
+      }
+    }
+    _accept.push_back(accept);
+
+    for (size_t cls = 0; cls < _nClasses; ++cls) {
+      std::vector<int> moved;
+      for (int s : set) {
+        if (_nfa[s].next >= 0 && _nfa[s].chars.test(classByte[cls])) {
+          moved.push_back(_nfa[s].next);
+        }
+      }
+      closure(moved);
+      _next.push_back(intern(moved));
+    }
+  }
+}
+
+/**
+ * @brief find the first pattern matching the whole of name
+ *
+ * @param name the file name to classify
+ *
+ * @return the matching format, or NULL if no pattern matches
+ */
+const fileNameFmt * nameMatcher::match(std::string_view name) const {
+  uint16_t state = _start;
+  for (unsigned char c : name) {
+    state = _next[state * _nClasses + _class[c]];
+    if (state == deadState) {
+      return NULL;
+    }
+  }
+  return _accept[state] < 0 ? NULL : &_table[_accept[state]];
+}
@@ -0,0 +1,81 @@
+#ifndef NAMEMATCHER_HPP
+#define NAMEMATCHER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <bitset>
+#include <stdint.h>
+
+#include "format.hpp"
+
+/**
+ * @brief classifies file names against every fileNameFmt pattern at once
+ *
+ * Exact names, regexes and globs are compiled together into one NFA, which
+ * is turned into a DFA over byte classes when the matcher is built. Matching
+ * a name is then a single pass of table lookups, one per byte, stopping
+ * early once no pattern can match. When several patterns match, the first
+ * in the table wins, as with a linear scan.
+ */
+class nameMatcher {
+  private:
+    // An NFA state, either a byte set transition or only epsilon moves
+    struct nfaState {
+      std::bitset<256> chars;   // bytes leading to next, none for epsilon only
+      int              next;    // target of the byte transition
+      std::vector<int> eps;     // epsilon transitions
+      int              accept;  // pattern index, -1 if not accepting
+    };
+
+    // Start and end states of a partially built NFA
+    struct fragment {
+      int start;
+      int end;
+    };
+
+    // Parser state for one pattern
+    struct parser {
+      const char       *pos;
+      const char       *end;
+      std::string_view  pattern;
+    };
+
+    static const uint16_t deadState = 0;
+
+    const fileNameFmt      *_table;
+    std::vector<nfaState>   _nfa;
+    std::vector<std::bitset<256> > _sets;  // byte sets used by the NFA
+
+    uint8_t                 _class[256];   // byte to byte class
+    size_t                  _nClasses;
+    std::vector<uint16_t>   _next;         // state * _nClasses + class
+    std::vector<int16_t>    _accept;       // pattern index per state, or -1
+    uint16_t                _start;
+
+  private:
+    int      newState();
+    fragment byteSet(const std::bitset<256> & chars);
+    fragment concat(fragment a, fragment b);
+    fragment alternate(fragment a, fragment b);
+    fragment repeat(fragment a, char op);
+
+    fragment parseAlt(parser & p);
+    fragment parseConcat(parser & p);
+    fragment parseAtom(parser & p);
+    fragment parseClass(parser & p, char negate);
+    fragment parseGlob(parser & p);
+    fragment literal(std::string_view name);
+    [[noreturn]] static void badPattern(const parser & p);
+
+    void closure(std::vector<int> & set) const;
+    void buildClasses();
+    void buildDfa(const std::vector<int> & starts);
+
+  public:
+    nameMatcher(const fileNameFmt *table, size_t n);
+
+    const fileNameFmt * match(std::string_view name) const;
+};
+
+#endif /* NAMEMATCHER_HPP */
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+#include "outWriter.hpp"
+
+/**
+ * @brief create a writer with an empty buffer
+ *
+ * @param fd the descriptor to write to
+ * @param size the buffer size, output is written once this much is waiting
+ */
+outWriter::outWriter(int fd, size_t size) :
+  _fd(fd),
+  _buf(new char[size]),
+  _size(size),
+  _len(0)
+  {}
+
+outWriter::~outWriter() {
+  flush();
+}
+
+/**
+ * @brief write out the buffer followed by extra, retrying partial writes
+ *
+ * A failed write is reported and ends the program, the rest of the listing
+ * would be lost anyway
+ *
+ * @param extra bytes written after the buffer, may be NULL
+ * @param n length of extra
+ */
+void outWriter::writeAll(const char *extra, size_t n) {
+  struct iovec iov[2] = {{_buf.get(), _len}, {(void *) extra, n}};
+  struct iovec *pos = iov;
+  int count = n > 0 ? 2 : 1;
+
+  while (count > 0 && _fd >= 0) {
+    ssize_t written = writev(_fd, pos, count);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("write: ");
+      _fd = -1;
+      _len = 0;
+      exit(-1);
+    }
+
+    // Skip past whatever made it out
+    while (count > 0 && (size_t) written >= pos->iov_len) {
+      written -= pos->iov_len;
+      ++pos;
+      --count;
+    }
+    if (count > 0) {
+      pos->iov_base = (char *) pos->iov_base + written;
+      pos->iov_len -= written;
+    }
+  }
+  _len = 0;
+}
+
+/**
+ * @brief handle a span that doesn't fit in what's left of the buffer
+ *
+ * Spans that would fit in an empty buffer are copied after a flush, larger
+ * ones go straight from the caller's memory
+ */
+void outWriter::spill(const char *data, size_t n) {
+  if (n < _size) {
+    flush();
+    memcpy(&_buf[0], data, n);
+    _len = n;
+  } else {
+    writeAll(data, n);
+  }
+}
+
+/**
+ * @brief write out everything buffered so far
+ */
+void outWriter::flush() {
+  if (_len > 0) {
+    writeAll(NULL, 0);
+  }
+}
+
+/**
+ * @brief append n spaces
+ */
+void outWriter::putSpaces(size_t n) {
+  static const char spaces[] = "                                ";
+  const size_t chunk = sizeof(spaces) - 1;
+  for (; n > chunk; n -= chunk) {
+    put(spaces, chunk);
+  }
+  put(spaces, n);
+}
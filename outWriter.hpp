@@ -0,0 +1,80 @@
+#ifndef OUTWRITER_HPP
+#define OUTWRITER_HPP
+
+#include <memory>
+#include <string_view>
+
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief buffered writer that all of the listing output goes through
+ *
+ * Fields and escape sequences are appended as byte spans to one contiguous
+ * buffer, which goes out with a single write once it is full. A span that
+ * doesn't fit is sent along with the buffer in one writev rather than
+ * being copied. Nothing is allocated after construction.
+ */
+class outWriter {
+  private:
+    int                     _fd;    // where the output goes, -1 after a failure
+    std::unique_ptr<char[]> _buf;
+    size_t                  _size;  // capacity of _buf
+    size_t                  _len;   // bytes waiting in _buf
+
+  private:
+    void spill(const char *data, size_t n);
+    void writeAll(const char *extra, size_t n);
+
+  public:
+    // Large enough that writes are rare, small enough to stay in cache
+    static const size_t defaultBufSize = 1 << 16;
+
+    outWriter(int fd = STDOUT_FILENO, size_t size = defaultBufSize);
+    ~outWriter();
+    outWriter(const outWriter &) = delete;
+    outWriter & operator=(const outWriter &) = delete;
+
+    /**
+     * @brief append a span of bytes
+     */
+    inline void put(const char *data, size_t n) {
+      if (n > _size - _len) {
+        spill(data, n);
+        return;
+      }
+      memcpy(&_buf[_len], data, n);
+      _len += n;
+    }
+
+    inline void put(std::string_view s) { put(s.data(), s.size()); }
+
+    inline void put(char c) {
+      if (_len == _size) {
+        flush();
+      }
+      _buf[_len++] = c;
+    }
+
+    /**
+     * @brief get room to format up to n bytes in place, finish with commit()
+     *
+     * @param n bytes needed, at most the buffer size
+     */
+    inline char * reserve(size_t n) {
+      if (n > _size - _len) {
+        flush();
+      }
+      return &_buf[_len];
+    }
+
+    /**
+     * @brief keep n bytes written into the space from reserve()
+     */
+    inline void commit(size_t n) { _len += n; }
+
+    void putSpaces(size_t n);
+    void flush();
+};
+
+#endif /* OUTWRITER_HPP */
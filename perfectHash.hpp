@@ -0,0 +1,103 @@
+#ifndef PERFECTHASH_HPP
+#define PERFECTHASH_HPP
+
+#include <string_view>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief seeded FNV-1a with a final mix so the low bits are usable
+ *
+ * @param key the string to hash
+ * @param seed picks one of a family of hash functions
+ *
+ * @return the 32-bit hash
+ */
+constexpr uint32_t seededHash(std::string_view key, uint32_t seed) {
+  uint32_t h = 2166136261u ^ seed;
+  for (char c : key) {
+    h ^= (unsigned char) c;
+    h *= 16777619u;
+  }
+  h ^= h >> 16;
+  h *= 0x7feb352du;
+  h ^= h >> 15;
+  return h;
+}
+
+/**
+ * @brief a collision free hash table over a constant array, built at compile time
+ *
+ * The constructor searches for a seed that sends every key of the table to
+ * its own slot, so a lookup is one hash, one slot load and one string
+ * compare. Entries with hashed() false are left out of the table.
+ *
+ * @tparam T the table's element type, with a string_view name
+ * @tparam N number of elements in the table
+ * @tparam M number of slots, a power of two comfortably above N * N / 8
+ */
+template <typename T, size_t N, size_t M>
+class perfectHash {
+  private:
+    static_assert((M & (M - 1)) == 0, "slot count must be a power of two");
+    static_assert(N < 255, "slots hold 8-bit indices");
+
+    const T  *_table;
+    uint32_t  _seed;
+    uint8_t   _slots[M];   // index + 1 into _table, 0 if empty
+
+  private:
+    /**
+     * @brief try to place every key with seed
+     *
+     * @return true if no two keys shared a slot
+     */
+    constexpr bool place(uint32_t seed) {
+      for (size_t s = 0; s < M; ++s) {
+        _slots[s] = 0;
+      }
+      for (size_t i = 0; i < N; ++i) {
+        if (!hashed(_table[i])) {
+          continue;
+        }
+        uint32_t slot = seededHash(_table[i].name, seed) & (M - 1);
+        if (_slots[slot] != 0) {
+          return false;
+        }
+        _slots[slot] = i + 1;
+      }
+      return true;
+    }
+
+  public:
+    constexpr perfectHash(const T (&table)[N]) : _table(table), _seed(0), _slots{} {
+      while (!place(_seed)) {
+        ++_seed;
+      }
+    }
+
+    /**
+     * @brief look up a key
+     *
+     * @param key the name to find
+     *
+     * @return the matching table entry, or NULL if there is none
+     */
+    constexpr const T * find(std::string_view key) const {
+      uint8_t slot = _slots[seededHash(key, _seed) & (M - 1)];
+      if (slot != 0 && key == _table[slot - 1].name) {
+        return &_table[slot - 1];
+      }
+      return NULL;
+    }
+};
+
+/**
+ * @brief build a perfectHash, deducing the table's type and size
+ */
+template <size_t M, typename T, size_t N>
+constexpr perfectHash<T, N, M> makePerfectHash(const T (&table)[N]) {
+  return perfectHash<T, N, M>(table);
+}
+
+#endif /* PERFECTHASH_HPP */
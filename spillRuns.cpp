@@ -0,0 +1,312 @@
+#include <algorithm>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spillRuns.hpp"
+
+namespace {
+
+/**
+ * @brief append n as a LEB128 varint
+ */
+void putVarint(std::string & out, uint64_t n) {
+  while (n >= 0x80) {
+    out += (char) (n | 0x80);
+    n >>= 7;
+  }
+  out += (char) n;
+}
+
+/**
+ * @brief read a LEB128 varint, advancing p past it
+ */
+uint64_t getVarint(const char *& p) {
+  uint64_t n = 0;
+  for (unsigned shift = 0; ; shift += 7) {
+    unsigned char c = *p++;
+    n |= (uint64_t) (c & 0x7f) << shift;
+    if (!(c & 0x80)) {
+      return n;
+    }
+  }
+}
+
+/**
+ * @brief write all of data to fd, exiting on failure
+ */
+void writeAll(int fd, const char *data, size_t n) {
+  while (n > 0) {
+    ssize_t done = write(fd, data, n);
+    if (done < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("lspp: spill");
+      exit(-1);
+    }
+    data += done;
+    n    -= done;
+  }
+}
+
+}
+
+/**
+ * @brief start with no runs
+ *
+ * A merge holds a buffer per run it reads and one for the run it writes,
+ * so the buffers are made as large as the limit allows for maxFanIn runs
+ * and as many runs are merged at once as then fit. Below a few buffers'
+ * worth the minimum of two runs is merged with minimum sized buffers.
+ *
+ * @param reverse merge from high keys to low, ties still in run order
+ * @param memLimit bytes the buffers of a merge may take up
+ */
+spillRuns::spillRuns(bool reverse, size_t memLimit) :
+  _reverse(reverse),
+  _bufSize(std::clamp(memLimit / (maxFanIn + 1), minBufSize, maxBufSize)),
+  _fanIn(std::clamp(memLimit / _bufSize, (size_t) 3, maxFanIn + 1) - 1)
+  {}
+
+spillRuns::~spillRuns() {
+  for (run & r : _runs) {
+    close(r.fd);
+  }
+}
+
+/**
+ * @brief create an unlinked temporary file in $TMPDIR, or /tmp
+ *
+ * @return the file's descriptor
+ */
+int spillRuns::create() {
+  const char *dir = getenv("TMPDIR");
+  std::string path = std::string(dir != NULL && *dir ? dir : "/tmp") + "/lspp-XXXXXX";
+  int fd = mkstemp(&path[0]);
+  if (fd < 0) {
+    perror("lspp: spill");
+    exit(-1);
+  }
+  unlink(path.c_str());
+  return fd;
+}
+
+/**
+ * @brief add a written run file to the runs, positioned on its first record
+ *
+ * @param level the number of merges that went into the run
+ */
+void spillRuns::open(int fd, unsigned level) {
+  if (lseek(fd, 0, SEEK_SET) < 0) {
+    perror("lspp: spill");
+    exit(-1);
+  }
+  _runs.push_back(run{fd, level, NULL, 0, 0, 0, 0, {}, {}, NULL});
+}
+
+/**
+ * @brief move a run on to its next record, reading more of it as needed
+ *
+ * The run's buffer is allocated on the first read, and grown to fit any
+ * record longer than it
+ *
+ * @return false once the run is used up
+ */
+bool spillRuns::next(run & r) {
+  r.pos += r.len;
+  r.len  = 0;
+  for (;;) {
+    size_t avail = r.end - r.pos;
+    size_t want  = sizeof(uint32_t);
+    if (avail >= want) {
+      uint32_t len;
+      memcpy(&len, &r.buf[r.pos], sizeof(len));
+      want += len;
+      if (avail >= want) {
+        r.len = want;
+        break;
+      }
+    }
+    // Move the partial record to the front and read the rest of it
+    if (want > r.cap) {
+      size_t cap = std::max({want, 2 * r.cap, _bufSize});
+      std::unique_ptr<char[]> buf(new char[cap]);
+      std::copy(r.buf.get() + r.pos, r.buf.get() + r.end, buf.get());
+      r.buf.swap(buf);
+      r.cap = cap;
+    } else {
+      memmove(&r.buf[0], &r.buf[r.pos], avail);
+    }
+    r.pos = 0;
+    r.end = avail;
+    ssize_t n = read(r.fd, &r.buf[r.end], r.cap - r.end);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("lspp: spill");
+      exit(-1);
+    }
+    if (n == 0) {
+      if (avail != 0) {
+        fprintf(stderr, "lspp: spill: run ends inside a record\n");
+        exit(-1);
+      }
+      return false;
+    }
+    r.end += n;
+  }
+
+  const char *p = &r.buf[r.pos] + sizeof(uint32_t);
+  size_t keyLen = getVarint(p);
+  r.key = std::string_view(p, keyLen);
+  p += keyLen;
+  size_t tieLen = getVarint(p);
+  r.tie = std::string_view(p, tieLen);
+  r.packed = p + tieLen;
+  return true;
+}
+
+/**
+ * @brief write a sorted listing out as a run
+ *
+ * Then while the last fanIn runs are all of one level they are merged
+ * into a run of the next level
+ *
+ * @param sorted the listing, stably sorted in the order of the keys
+ * @param keyOf builds each entry's keys
+ */
+void spillRuns::add(const fileList & sorted, const keyFn & keyOf) {
+  int fd = create();
+  const entryStore & store = *sorted.getStore();
+  std::string out, key, tie, rec;
+  for (const fileEnt & f : sorted) {
+    key.clear();
+    tie.clear();
+    keyOf(f, key, tie);
+    rec.clear();
+    putVarint(rec, key.size());
+    rec += key;
+    putVarint(rec, tie.size());
+    rec += tie;
+    store.pack(f.getIndex(), rec);
+
+    uint32_t len = rec.size();
+    out.append((const char *) &len, sizeof(len));
+    out += rec;
+    if (out.size() >= _bufSize) {
+      writeAll(fd, out.data(), out.size());
+      out.clear();
+    }
+  }
+  writeAll(fd, out.data(), out.size());
+  open(fd, 0);
+
+  // Levels never rise along the runs, so the last fanIn are of one level
+  // if the first of them is of the last one's
+  while (_runs.size() >= _fanIn &&
+         _runs[_runs.size() - _fanIn].level == _runs.back().level) {
+    mergeTail(_runs.size() - _fanIn);
+  }
+}
+
+/**
+ * @brief merge the runs from first on into one run that takes their place
+ */
+void spillRuns::mergeTail(size_t first) {
+  int fd = create();
+  const size_t bufSize = _bufSize;
+  std::string out;
+  mergeRuns(first, [fd, bufSize, &out](const char *rec, size_t len) {
+              out.append(rec, len);
+              if (out.size() >= bufSize) {
+                writeAll(fd, out.data(), out.size());
+                out.clear();
+              }});
+  writeAll(fd, out.data(), out.size());
+
+  const unsigned level = _runs[first].level + 1;
+  for (size_t i = first; i < _runs.size(); ++i) {
+    close(_runs[i].fd);
+  }
+  _runs.erase(_runs.begin() + first, _runs.end());
+  open(fd, level);
+}
+
+/**
+ * @brief merge the runs from first on, passing each record on in order
+ *
+ * A heap holds the runs by their current record, the one to take next on
+ * top. The runs are used up afterwards.
+ *
+ * @param first the first run to merge, the rest up to the last go with it
+ * @param fn called with each whole record, length prefix included
+ */
+void spillRuns::mergeRuns(size_t first, const std::function<void(const char *rec, size_t len)> & fn) {
+  std::vector<uint32_t> heap;
+  for (uint32_t i = first; i < _runs.size(); ++i) {
+    if (next(_runs[i])) {
+      heap.push_back(i);
+    }
+  }
+
+  auto after = [this](uint32_t x, uint32_t y) {
+    const run & a = _runs[x];
+    const run & b = _runs[y];
+    int cmp = a.key.compare(b.key);
+    if (cmp == 0) {
+      cmp = a.tie.compare(b.tie);
+    }
+    if (cmp != 0) {
+      return _reverse ? cmp < 0 : cmp > 0;
+    }
+    return x > y;
+  };
+  std::make_heap(heap.begin(), heap.end(), after);
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), after);
+    run & r = _runs[heap.back()];
+    fn(&r.buf[r.pos], r.len);
+    if (next(r)) {
+      std::push_heap(heap.begin(), heap.end(), after);
+    } else {
+      heap.pop_back();
+    }
+  }
+}
+
+/**
+ * @brief merge the runs back into a listing, a batch of entries at a time
+ *
+ * @param dir the directory the entries are in
+ * @param batchSize entries handed over at once
+ * @param fn called with each batch, in order
+ */
+void spillRuns::merge(const std::shared_ptr<dirHandle> & dir, size_t batchSize,
+                      const std::function<void(fileList & batch)> & fn) {
+  // Bring the runs down to fanIn, merging the shortest, last, ones first
+  while (_runs.size() > _fanIn) {
+    mergeTail(_runs.size() - std::min(_fanIn, _runs.size() - _fanIn + 1));
+  }
+
+  fileList batch;
+  mergeRuns(0, [&](const char *rec, size_t) {
+             // Skip the length and both keys to the packed entry
+             const char *p = rec + sizeof(uint32_t);
+             size_t keyLen = getVarint(p);
+             p += keyLen;
+             size_t tieLen = getVarint(p);
+             p += tieLen;
+             batch.unpack(dir, p);
+             if (batch.size() == batchSize) {
+               fn(batch);
+               batch.reuse();
+             }});
+  if (!batch.empty()) {
+    fn(batch);
+  }
+}
@@ -0,0 +1,78 @@
+#ifndef SPILLRUNS_HPP
+#define SPILLRUNS_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stddef.h>
+
+#include "fileList.hpp"
+
+/**
+ * @brief sorted runs of packed entries written out to temporary files, and
+ *        their merge
+ *
+ * Each record holds the entry's merge key, a second key that settles ties
+ * in the first, and the entry packed by entryStore::pack(). Runs are merged
+ * on the keys with equal records taken from earlier runs first, so if the
+ * runs are consecutive pieces of a listing, each sorted stably, the merge
+ * is the stable sort of the whole listing. The files are unlinked as soon
+ * as they are created and only runs being merged hold a buffer in memory.
+ *
+ * Runs are merged a level at a time: once fanIn runs of the same level
+ * are waiting they are merged into one run of the next level, so every
+ * record is rewritten once per level rather than once per merge. The
+ * buffers and fanIn are sized so a merge stays within the memory limit.
+ */
+class spillRuns {
+  public:
+    // Builds the merge key and tie key of an entry
+    typedef std::function<void(const fileEnt & f, std::string & key, std::string & tie)> keyFn;
+
+  private:
+    struct run {
+      int                     fd;
+      unsigned                level;  // merges that went into the run
+      std::unique_ptr<char[]> buf;    // allocated when the run is merged
+      size_t                  cap;    // size of buf
+      size_t                  pos;    // start of the current record in buf
+      size_t                  end;    // valid bytes in buf
+      size_t                  len;    // length of the current record
+      std::string_view        key;    // of the current record
+      std::string_view        tie;
+      const char             *packed; // the current record's packed entry
+    };
+
+    bool             _reverse;
+    size_t           _bufSize;  // read and write buffer per run
+    size_t           _fanIn;    // runs merged at once
+    std::vector<run> _runs;
+
+  private:
+    int  create();
+    void open(int fd, unsigned level);
+    bool next(run & r);
+    void mergeTail(size_t first);
+    void mergeRuns(size_t first, const std::function<void(const char *rec, size_t len)> & fn);
+
+  public:
+    // Bounds on the runs merged at once and on their buffers
+    static constexpr size_t maxFanIn   = 64;
+    static constexpr size_t minBufSize = 1 << 12;
+    static constexpr size_t maxBufSize = 1 << 16;
+
+    spillRuns(bool reverse, size_t memLimit);
+    ~spillRuns();
+    spillRuns(const spillRuns &) = delete;
+    spillRuns & operator=(const spillRuns &) = delete;
+
+    void   add(const fileList & sorted, const keyFn & keyOf);
+    void   merge(const std::shared_ptr<dirHandle> & dir, size_t batchSize,
+                 const std::function<void(fileList & batch)> & fn);
+
+    size_t size() const { return _runs.size(); }
+};
+
+#endif /* SPILLRUNS_HPP */
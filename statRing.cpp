@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <memory>
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "statRing.hpp"
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *p) {
+  return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+  return syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+/**
+ * @brief set up and map an io_uring with room for entries requests
+ *
+ * @param entries number of statx requests submitted at a time
+ */
+statRing::statRing(unsigned entries) :
+  _fd(-1),
+  _entries(0),
+  _sqRing(MAP_FAILED),
+  _cqRing(MAP_FAILED),
+  _sqes(MAP_FAILED),
+  _retired(false)
+  {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = io_uring_setup(entries, &p);
+    if (fd < 0) {
+      // No io_uring in this kernel or it has been disabled
+      return;
+    }
+
+    _sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    _cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    _sqesSize   = p.sq_entries * sizeof(struct io_uring_sqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+      _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+    }
+
+    _sqRing = mmap(NULL, _sqRingSize, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (_sqRing == MAP_FAILED) {
+      close(fd);
+      return;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+      _cqRing = _sqRing;
+    } else {
+      _cqRing = mmap(NULL, _cqRingSize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    }
+    _sqes = mmap(NULL, _sqesSize, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (_cqRing == MAP_FAILED || _sqes == MAP_FAILED) {
+      close(fd);
+      return;
+    }
+
+    char *sq = (char *) _sqRing;
+    _sqHead  = (unsigned *) (sq + p.sq_off.head);
+    _sqTail  = (unsigned *) (sq + p.sq_off.tail);
+    _sqMask  = (unsigned *) (sq + p.sq_off.ring_mask);
+    _sqArray = (unsigned *) (sq + p.sq_off.array);
+
+    char *cq = (char *) _cqRing;
+    _cqHead  = (unsigned *) (cq + p.cq_off.head);
+    _cqTail  = (unsigned *) (cq + p.cq_off.tail);
+    _cqMask  = (unsigned *) (cq + p.cq_off.ring_mask);
+    _cqes    = cq + p.cq_off.cqes;
+
+    _entries = p.sq_entries;
+    _results.resize(_entries);
+    _fd = fd;
+  }
+
+statRing::~statRing() {
+  if (_sqes != MAP_FAILED) {
+    munmap(_sqes, _sqesSize);
+  }
+  if (_cqRing != MAP_FAILED && _cqRing != _sqRing) {
+    munmap(_cqRing, _cqRingSize);
+  }
+  if (_sqRing != MAP_FAILED) {
+    munmap(_sqRing, _sqRingSize);
+  }
+  if (_fd >= 0) {
+    close(_fd);
+  }
+}
+
+/**
+ * @brief submit the queued requests and wait for all of them to complete
+ *
+ * @param nSubmit number of requests added to the submission ring
+ *
+ * @return false if the ring stopped working
+ */
+bool statRing::submitAndWait(unsigned nSubmit) {
+  unsigned submitted = 0;
+  while (submitted < nSubmit) {
+    int ret = io_uring_enter(_fd, nSubmit - submitted, nSubmit - submitted,
+                             IORING_ENTER_GETEVENTS);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      abandon(submitted);
+      return false;
+    }
+    submitted += ret;
+  }
+
+  // Only reached early if a wait was interrupted
+  for (;;) {
+    unsigned ready = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE) - *_cqHead;
+    if (ready >= nSubmit) {
+      return true;
+    }
+    if (io_uring_enter(_fd, 0, nSubmit - ready, IORING_ENTER_GETEVENTS) < 0 &&
+        errno != EINTR) {
+      abandon(nSubmit);
+      return false;
+    }
+  }
+}
+
+/**
+ * @brief take back a batch the ring failed part way through
+ *
+ * Requests the kernel hasn't consumed are dropped from the submission ring
+ * and the ones it has are waited for, so none of them can write into the
+ * result buffers after their directories are unpinned and the caller
+ * stats the entries itself. If even waiting fails the ring is retired and
+ * its buffers are never handed out again.
+ *
+ * @param submitted number of requests the kernel accepted
+ */
+void statRing::abandon(unsigned submitted) {
+  __atomic_store_n(_sqTail, __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+
+  for (;;) {
+    unsigned ready = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE) - *_cqHead;
+    if (ready >= submitted) {
+      break;
+    }
+    if (io_uring_enter(_fd, 0, submitted - ready, IORING_ENTER_GETEVENTS) < 0 &&
+        errno != EINTR) {
+      _retired = true;
+      break;
+    }
+  }
+  __atomic_store_n(_cqHead, __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief statx every entry through the ring, a full ring at a time
+ *
+ * Results land in a buffer per ring slot and only the fields the store keeps
+ * are copied out of them. Entries the kernel can't handle through io_uring
+ * are stat'd synchronously. Each entry's directory is pinned until its batch
+ * has completed.
+ *
+ * @param filenames the entries to stat
+ *
+ * @return false if the ring failed, the remaining entries are left unstat'd
+ */
+bool statRing::statAll(fileList & filenames) {
+  struct io_uring_sqe *sqes = (struct io_uring_sqe *) _sqes;
+  struct io_uring_cqe *cqes = (struct io_uring_cqe *) _cqes;
+
+  for (size_t i = 0; i < filenames.size(); ) {
+    unsigned batch = std::min((size_t) _entries, filenames.size() - i);
+
+    // Queue a statx for each entry into the result buffer of its slot
+    std::vector<std::unique_ptr<dirHandle::pinGuard> > pins;
+    dirHandle *pinned = NULL;
+    unsigned tail = *_sqTail;
+    for (unsigned k = 0; k < batch; ++k, ++tail) {
+      const fileEnt f = filenames[i + k];
+      if (f.getDir().get() != pinned) {
+        pinned = f.getDir().get();
+        pins.emplace_back(new dirHandle::pinGuard(*pinned));
+      }
+      unsigned index = tail & *_sqMask;
+      struct io_uring_sqe *sqe = &sqes[index];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode      = IORING_OP_STATX;
+      sqe->fd          = pins.back()->fd();
+      sqe->addr        = (unsigned long) f.nameStr();
+      sqe->len         = fileEnt::statxMask;
+      sqe->addr2       = (unsigned long) &_results[k];
+      sqe->statx_flags = AT_STATX_DONT_SYNC;
+      sqe->user_data   = k;
+      _sqArray[index]  = index;
+    }
+    __atomic_store_n(_sqTail, tail, __ATOMIC_RELEASE);
+
+    if (!submitAndWait(batch)) {
+      return false;
+    }
+
+    // Reap the completions
+    unsigned head = *_cqHead;
+    unsigned cqTail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+    for (; head != cqTail; ++head) {
+      struct io_uring_cqe *cqe = &cqes[head & *_cqMask];
+      const fileEnt f = filenames[i + cqe->user_data];
+      if (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP) {
+        // Kernel predates IORING_OP_STATX
+        f.loadStat();
+      } else if (cqe->res < 0) {
+        errno = -cqe->res;
+        perror("fileEnt::fileEnt");
+        f._store->clearStat(f._idx);
+      } else {
+        f._store->setStat(f._idx, _results[cqe->user_data], fileEnt::timeSel);
+      }
+    }
+    __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+
+    i += batch;
+  }
+  return true;
+}
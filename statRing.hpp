@@ -0,0 +1,62 @@
+#ifndef STATRING_HPP
+#define STATRING_HPP
+
+#include <vector>
+
+#include "fileEnt.hpp"
+#include "fileList.hpp"
+
+/**
+ * @brief an io_uring used to statx a whole directory in a few submissions
+ *
+ * Talks to the kernel through the raw io_uring syscalls so no liburing is
+ * needed. If the kernel has no io_uring, ok() is false and the caller should
+ * use the synchronous path instead.
+ */
+class statRing {
+  private:
+    int       _fd;          // ring file descriptor
+    unsigned  _entries;     // number of submission queue entries
+
+    // Mapped ring memory
+    void     *_sqRing;
+    void     *_cqRing;
+    void     *_sqes;
+    size_t    _sqRingSize;
+    size_t    _cqRingSize;
+    size_t    _sqesSize;
+
+    // Pointers into the submission ring
+    unsigned *_sqHead;
+    unsigned *_sqTail;
+    unsigned *_sqMask;
+    unsigned *_sqArray;
+
+    // Pointers into the completion ring
+    unsigned *_cqHead;
+    unsigned *_cqTail;
+    unsigned *_cqMask;
+    void     *_cqes;
+
+    // One statx result buffer per submission slot
+    std::vector<struct statx> _results;
+
+    // Set if requests may still be in flight after a failure
+    bool      _retired;
+
+  private:
+    bool submitAndWait(unsigned nSubmit);
+    void abandon(unsigned submitted);
+
+  public:
+    // Requests submitted per io_uring_enter call
+    static const unsigned defaultEntries = 4096;
+
+    statRing(unsigned entries = defaultEntries);
+    ~statRing();
+
+    bool ok() const { return _fd >= 0 && !_retired; }
+    bool statAll(fileList & filenames);
+};
+
+#endif /* STATRING_HPP */
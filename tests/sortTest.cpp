@@ -0,0 +1,158 @@
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../keySort.hpp"
+#include "../workerPool.hpp"
+
+/**
+ * @brief check that the sorts shared between threads give the serial order
+ *
+ * Usage: sortTest [JOBS]
+ *
+ * Listings a little over 2 * parallelSortMin entries, so that radixSort()
+ * splits and merges them and sortTies() shares its tie runs, are sorted on
+ * pools of 1 to JOBS threads (default 4). Keys with many duplicates must
+ * come out exactly as the serial radixSort() leaves them, and names that
+ * share long prefixes exactly as a stable sort on the names, ascending and
+ * with the keys flipped to sort descending.
+ */
+
+static int failures = 0;
+
+/**
+ * @brief report a test that didn't give the expected order
+ */
+static void check(bool ok, const char *what, unsigned jobs) {
+  if (!ok) {
+    fprintf(stderr, "sortTest: %s differs at %u jobs\n", what, jobs);
+    ++failures;
+  }
+}
+
+static bool sameOrder(const std::vector<sortKey> & a, const std::vector<sortKey> & b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                    [](const sortKey & x, const sortKey & y) {
+                      return x.key == y.key && x.idx == y.idx; });
+}
+
+/**
+ * @brief radixSort() on a pool against the serial radixSort()
+ *
+ * @param keys the keys in input order
+ */
+static void checkRadix(const std::vector<sortKey> & keys, const char *what, unsigned maxJobs) {
+  std::vector<sortKey> serial(keys);
+  radixSort(serial);
+  for (unsigned jobs = 1; jobs <= maxJobs; ++jobs) {
+    workerPool pool(jobs);
+    std::vector<sortKey> shared(keys);
+    radixSort(shared, pool);
+    check(sameOrder(serial, shared), what, jobs);
+  }
+}
+
+/**
+ * @brief a prefix sort finished by sortTies() against a stable sort on the
+ *        whole strings
+ *
+ * @param strs each entry's strings, levels of them back to back
+ */
+static void checkTies(const std::vector<std::string> & strs, unsigned levels, bool foldCase,
+                      bool reverse, const char *what, unsigned maxJobs) {
+  const size_t n = strs.size() / levels;
+  auto keyOf = [&strs, levels](uint32_t idx, unsigned level) {
+    return std::string_view(strs[idx * levels + level]);
+  };
+  auto compare = [foldCase](std::string_view a, std::string_view b) {
+    for (size_t i = 0; i < a.size() && i < b.size(); ++i) {
+      int x = foldCase ? tolower((unsigned char) a[i]) : (unsigned char) a[i];
+      int y = foldCase ? tolower((unsigned char) b[i]) : (unsigned char) b[i];
+      if (x != y) {
+        return x < y ? -1 : 1;
+      }
+    }
+    return a.size() < b.size() ? -1 : a.size() > b.size();
+  };
+
+  std::vector<uint32_t> expected(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    expected[i] = i;
+  }
+  std::stable_sort(expected.begin(), expected.end(), [&](uint32_t x, uint32_t y) {
+    for (unsigned level = 0; level < levels; ++level) {
+      int cmp = compare(keyOf(x, level), keyOf(y, level));
+      if (cmp != 0) {
+        return reverse ? cmp > 0 : cmp < 0;
+      }
+    }
+    return false;
+  });
+
+  const uint64_t flip = reverse ? ~0ull : 0;
+  for (unsigned jobs = 1; jobs <= maxJobs; ++jobs) {
+    workerPool pool(jobs);
+    std::vector<sortKey> keys(n);
+    for (uint32_t i = 0; i < n; ++i) {
+      keys[i] = sortKey{prefixKey(keyOf(i, 0), foldCase) ^ flip, i};
+    }
+    radixSort(keys, pool);
+    sortTies(keys, keyOf, levels, foldCase, reverse, pool);
+    check(std::equal(keys.begin(), keys.end(), expected.begin(), expected.end(),
+                     [](const sortKey & k, uint32_t idx) { return k.idx == idx; }),
+          what, jobs);
+  }
+}
+
+int main(int argc, char **argv) {
+  const unsigned maxJobs = argc > 1 ? strtoul(argv[1], NULL, 10) : 4;
+  const size_t n = 2 * parallelSortMin + 10000;
+  std::mt19937_64 rng(1);
+
+  std::vector<sortKey> keys(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    keys[i] = sortKey{rng() % 1000, i};
+  }
+  checkRadix(keys, "radixSort of duplicate keys", maxJobs);
+  for (sortKey & k : keys) {
+    k.key ^= ~0ull;
+  }
+  checkRadix(keys, "radixSort of flipped keys", maxJobs);
+  for (sortKey & k : keys) {
+    k.key = rng();
+  }
+  checkRadix(keys, "radixSort of distinct keys", maxJobs);
+
+  // Names that all tie on their first 16 bytes, differ in case at the
+  // 16th, and repeat, so the ties are shared out over two levels
+  std::vector<std::string> names(n);
+  char buf[64];
+  for (size_t i = 0; i < n; ++i) {
+    snprintf(buf, sizeof(buf), "shared_prefix_a%c%09llu.%s", rng() % 2 ? 'a' : 'A',
+             (unsigned long long) (rng() % (n / 2)), rng() % 3 ? "txt" : "c");
+    names[i] = buf;
+  }
+  checkTies(names, 1, true, false, "folded name sort", maxJobs);
+  checkTies(names, 1, true, true, "reversed folded name sort", maxJobs);
+
+  // Extension then name, as -X sorts
+  std::vector<std::string> extNames;
+  extNames.reserve(2 * n);
+  for (const std::string & name : names) {
+    extNames.push_back(name.substr(name.find_last_of('.') + 1));
+    extNames.push_back(name);
+  }
+  checkTies(extNames, 2, false, false, "extension sort", maxJobs);
+  checkTies(extNames, 2, false, true, "reversed extension sort", maxJobs);
+
+  if (failures == 0) {
+    printf("sortTest: ok\n");
+  }
+  return failures != 0;
+}
@@ -0,0 +1,55 @@
+#!/bin/bash
+# Check that listings sorted on disk under --mem-limit come out the same
+# as when sorted in memory: a --flat tree whose paths are longer than the
+# merge buffers, and a directory spilled into enough runs to be merged a
+# level at a time.
+#
+# Usage: tests/spill.sh [LSPP]
+
+lspp=${1:-./lspp}
+tmp=$(mktemp -d "${TMPDIR:-/tmp}/lspp-test-XXXXXX") || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+# 400 levels of 200 byte names with a file in each, paths up to 80K,
+# past PATH_MAX, so one step down at a time
+long=$(printf '%0200d' 0)
+mkdir "$tmp/deep"
+(
+  cd "$tmp/deep" || exit 1
+  for level in $(seq 400); do
+    : > "f$level.$long"
+    mkdir "d$level.$long" && cd "d$level.$long" || exit 1
+  done
+) || exit 1
+
+mkdir "$tmp/wide"
+(
+  cd "$tmp/wide" || exit 1
+  for i in $(seq 3000); do
+    : > "file$i.$((i * 7919 % 3001))"
+  done
+) || exit 1
+
+fail=0
+check() {
+  "$lspp" "$@" > "$tmp/mem" 2>&1
+  "$lspp" --mem-limit=4K "$@" > "$tmp/spill" 2>&1
+  if ! cmp -s "$tmp/mem" "$tmp/spill"; then
+    echo "FAIL: lspp --mem-limit=4K $*: $(wc -l < "$tmp/spill") lines, $(wc -l < "$tmp/mem") expected"
+    fail=1
+  fi
+}
+
+entries=$(find "$tmp/deep" -mindepth 1 | wc -l)
+lines=$("$lspp" --flat -1 --mem-limit=4K "$tmp/deep" | wc -l)
+if [ "$lines" -ne "$entries" ]; then
+  echo "FAIL: lspp --flat --mem-limit=4K: $lines lines for $entries entries"
+  fail=1
+fi
+for opts in "" "-r" "-X" "-S -r" "-l"; do
+  check --flat -1 $opts "$tmp/deep"
+  check -1 $opts "$tmp/wide"
+done
+
+[ $fail -eq 0 ] && echo "spill: ok"
+exit $fail
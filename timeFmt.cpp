@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "timeFmt.hpp"
+#include "fieldFmt.hpp"
+
+namespace {
+
+const int64_t daySecs  = 60 * 60 * 24;
+const int64_t yearSecs = daySecs * 365;
+
+// Date formats and whether the clock follows, for recent and old timestamps
+struct styleSpec {
+  const char *recentDate;
+  const char *oldDate;
+  bool        recentClock;
+  bool        oldClock;
+};
+
+const styleSpec styles[] = {
+  {"%b %d ",    "%b %d %Y ", true, false},   // localeStyle
+  {"%m-%d ",    "%Y-%m-%d ", true, false},   // isoStyle
+  {"%Y-%m-%d ", "%Y-%m-%d ", true, true },   // longIsoStyle
+  {"%Y-%m-%d ", "%Y-%m-%d ", true, true }    // fullIsoStyle
+};
+
+inline int64_t floorDiv(int64_t a, int64_t b) {
+  return a / b - (a % b < 0);
+}
+
+/**
+ * @brief UTC offset in effect at sec, or a value no offset has on failure
+ */
+long offsetAt(int64_t sec) {
+  time_t t = sec;
+  struct tm tm;
+  return localtime_r(&t, &tm) ? tm.tm_gmtoff : -1;
+}
+
+inline char * putPair(char *pos, unsigned val) {
+  memcpy(pos, &digitPairs.pairs[2 * val], 2);
+  return pos + 2;
+}
+
+}
+
+/**
+ * @brief load the timezone rules, the default style is localeStyle
+ */
+timeFmt::timeFmt() :
+  _style(localeStyle),
+  _now(time(0)),
+  _last(NULL)
+  {
+    tzset();
+  }
+
+/**
+ * @brief select a style from a --time-style argument
+ *
+ * @param arg full-iso, long-iso, iso, locale or +FORMAT, where FORMAT may be
+ *            FORMAT1<newline>FORMAT2 to format old and recent times apart.
+ *            A posix- prefix is accepted, the listing is always in the
+ *            POSIX locale so those styles fall back to locale.
+ *
+ * @return false if arg isn't a style
+ */
+bool timeFmt::setStyle(const std::string & arg) {
+  _spans.clear();
+  _buckets.clear();
+  _last = NULL;
+
+  if (arg.compare(0, 6, "posix-") == 0) {
+    if (!setStyle(arg.substr(6))) {
+      return false;
+    }
+    _style = localeStyle;
+  } else if (!arg.compare("full-iso")) {
+    _style = fullIsoStyle;
+  } else if (!arg.compare("long-iso")) {
+    _style = longIsoStyle;
+  } else if (!arg.compare("iso")) {
+    _style = isoStyle;
+  } else if (!arg.compare("locale")) {
+    _style = localeStyle;
+  } else if (!arg.empty() && arg[0] == '+') {
+    size_t split = arg.find('\n');
+    _oldFmt    = arg.substr(1, split == std::string::npos ? split : split - 1);
+    _recentFmt = split == std::string::npos ? _oldFmt : arg.substr(split + 1);
+    _style = customStyle;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief find the cached span holding sec, rendering its date if there is none
+ */
+const timeFmt::daySpan & timeFmt::span(int64_t sec) {
+  auto bucket = _buckets.find(floorDiv(sec, daySecs));
+  if (bucket != _buckets.end()) {
+    for (const daySpan *s : bucket->second) {
+      if (sec >= s->lo && sec < s->hi) {
+        return *s;
+      }
+    }
+  }
+  return addSpan(sec);
+}
+
+/**
+ * @brief render the date of sec and work out how far that rendering holds
+ *
+ * The span starts as the whole local day under sec's UTC offset and is
+ * narrowed to the transition on either side if the offset changes during
+ * the day. Days have at most one transition, so a binary search finds it.
+ */
+const timeFmt::daySpan & timeFmt::addSpan(int64_t sec) {
+  daySpan s;
+  memset(&s, 0, sizeof(s));
+
+  time_t t = sec;
+  struct tm tm;
+  if (localtime_r(&t, &tm) == NULL) {
+    // Out of range for a broken down time, show the raw seconds
+    s.lo = sec;
+    s.hi = sec + 1;
+    s.todAtLo = -1;
+    s.recentLen = s.oldLen = snprintf(s.recent, sizeof(s.recent), "%lld ", (long long) sec);
+    memcpy(s.old, s.recent, sizeof(s.old));
+  } else {
+    long   off = tm.tm_gmtoff;
+    int64_t tod = tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+    s.lo = sec - tod;
+    s.hi = s.lo + daySecs;
+
+    if (offsetAt(s.lo) != off) {
+      int64_t a = s.lo;
+      int64_t b = sec;
+      while (b - a > 1) {
+        int64_t mid = a + (b - a) / 2;
+        (offsetAt(mid) == off ? b : a) = mid;
+      }
+      s.lo = b;
+    }
+    if (offsetAt(s.hi - 1) != off) {
+      int64_t a = sec;
+      int64_t b = s.hi - 1;
+      while (b - a > 1) {
+        int64_t mid = a + (b - a) / 2;
+        (offsetAt(mid) == off ? a : b) = mid;
+      }
+      s.hi = b;
+    }
+    s.todAtLo = tod - (sec - s.lo);
+
+    const styleSpec & spec = styles[_style == customStyle ? localeStyle : _style];
+    s.recentLen = strftime(s.recent, sizeof(s.recent), spec.recentDate, &tm);
+    s.oldLen    = strftime(s.old, sizeof(s.old), spec.oldDate, &tm);
+    s.zoneLen   = strftime(s.zone, sizeof(s.zone), "%z", &tm);
+  }
+
+  _spans.push_back(s);
+  const daySpan *added = &_spans.back();
+  for (int64_t day = floorDiv(s.lo, daySecs); day <= floorDiv(s.hi - 1, daySecs); ++day) {
+    _buckets[day].push_back(added);
+  }
+  return *added;
+}
+
+/**
+ * @brief render a +FORMAT style timestamp, which gets no caching
+ */
+size_t timeFmt::formatCustom(char *dst, const struct statx_timestamp & ts) const {
+  time_t t = ts.tv_sec;
+  struct tm tm;
+  if (localtime_r(&t, &tm) == NULL) {
+    return 0;
+  }
+  const std::string & fmt = _now - ts.tv_sec < yearSecs ? _recentFmt : _oldFmt;
+  return strftime(dst, maxWidth, fmt.c_str(), &tm);
+}
+
+/**
+ * @brief write a timestamp in the selected style
+ *
+ * @param dst room for maxWidth bytes
+ * @param ts the timestamp, nanoseconds are shown by full-iso
+ *
+ * @return bytes written
+ */
+size_t timeFmt::format(char *dst, const struct statx_timestamp & ts) {
+  if (_style == customStyle) {
+    return formatCustom(dst, ts);
+  }
+
+  int64_t sec = ts.tv_sec;
+  const daySpan *s = _last;
+  if (s == NULL || sec < s->lo || sec >= s->hi) {
+    s = &span(sec);
+    _last = s;
+  }
+
+  // Print the time when under a year old, otherwise the year
+  const styleSpec & spec = styles[_style];
+  bool recent = _now - sec < yearSecs;
+  char *pos = dst;
+  if (recent) {
+    memcpy(pos, s->recent, s->recentLen);
+    pos += s->recentLen;
+  } else {
+    memcpy(pos, s->old, s->oldLen);
+    pos += s->oldLen;
+  }
+  if (!(recent ? spec.recentClock : spec.oldClock) || s->todAtLo < 0) {
+    return pos - dst;
+  }
+
+  int64_t tod = s->todAtLo + (sec - s->lo);
+  pos = putPair(pos, tod / 3600);
+  *pos++ = ':';
+  pos = putPair(pos, tod / 60 % 60);
+  if (_style == fullIsoStyle) {
+    *pos++ = ':';
+    pos = putPair(pos, tod % 60);
+    *pos++ = '.';
+    uint32_t nsec = ts.tv_nsec;
+    pos[8] = '0' + nsec % 10;
+    nsec /= 10;
+    for (int i = 6; i >= 0; i -= 2) {
+      putPair(pos + i, nsec % 100);
+      nsec /= 100;
+    }
+    pos += 9;
+    *pos++ = ' ';
+    memcpy(pos, s->zone, s->zoneLen);
+    pos += s->zoneLen;
+  }
+  return pos - dst;
+}
@@ -0,0 +1,76 @@
+#ifndef TIMEFMT_HPP
+#define TIMEFMT_HPP
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+/**
+ * @brief renders long listing timestamps in one of the --time-style styles
+ *
+ * The timezone rules are loaded once. The first timestamp seen on a local
+ * calendar day renders that day's date through localtime and strftime, and
+ * the result is kept along with the span of seconds the day covers. Any
+ * later timestamp inside the span only has its time of day written, from
+ * its offset into the span. Spans stop at UTC offset changes, so a day
+ * with a daylight saving transition is cached as two spans.
+ *
+ * Not thread safe, timestamps are only rendered while printing.
+ */
+class timeFmt {
+  public:
+    enum style : int {
+      localeStyle  = 0,   // Oct 17 11:54, or Oct 17 2023 when old (default)
+      isoStyle     = 1,   // 10-17 11:54, or 2023-10-17 when old
+      longIsoStyle = 2,   // 2023-10-17 11:54
+      fullIsoStyle = 3,   // 2023-10-17 11:54:02.123456789 +0000
+      customStyle  = 4    // +FORMAT, passed to strftime for every entry
+    };
+
+    // Longest rendered timestamp, custom formats are cut off here
+    static const size_t maxWidth = 128;
+
+  private:
+    // Part of a local calendar day over which the UTC offset doesn't change
+    struct daySpan {
+      int64_t lo;           // first second of the span
+      int64_t hi;           // one past the last second
+      int32_t todAtLo;      // local seconds since midnight at lo
+      uint8_t recentLen;
+      uint8_t oldLen;
+      uint8_t zoneLen;
+      char    recent[32];   // date prefix for recent timestamps
+      char    old[32];      // date prefix for old timestamps
+      char    zone[8];      // numeric UTC offset, ex +0200
+    };
+
+    style       _style;
+    std::string _recentFmt;   // custom strftime formats
+    std::string _oldFmt;
+    int64_t     _now;         // timestamps at least a year before are old
+
+    std::deque<daySpan>  _spans;
+    // Spans overlapping each UTC day, there are rarely more than two
+    std::unordered_map<int64_t, std::vector<const daySpan *> > _buckets;
+    const daySpan       *_last;   // span of the previous timestamp
+
+  private:
+    const daySpan & span(int64_t sec);
+    const daySpan & addSpan(int64_t sec);
+    size_t formatCustom(char *dst, const struct statx_timestamp & ts) const;
+
+  public:
+    timeFmt();
+    timeFmt(const timeFmt &) = delete;
+    timeFmt & operator=(const timeFmt &) = delete;
+
+    bool setStyle(const std::string & arg);
+
+    size_t format(char *dst, const struct statx_timestamp & ts);
+};
+
+#endif /* TIMEFMT_HPP */
@@ -0,0 +1,116 @@
+#include <algorithm>
+
+#include "topList.hpp"
+
+// Dropped entries are compacted out once they outnumber the kept ones and
+// this many more
+static const size_t compactSlack = 1 << 10;
+
+/**
+ * @brief keep the first or last n entries of a listing
+ *
+ * @param n how many entries to keep
+ * @param last keep the last n rather than the first
+ * @param reverse the listing is sorted from high keys to low
+ */
+topList::topList(size_t n, bool last, bool reverse) :
+  _n(n),
+  _last(last),
+  _reverse(reverse),
+  _seq(0)
+  {}
+
+/**
+ * @brief check if x comes before y in the listing
+ */
+bool topList::precedes(const rank & x, const rank & y) const {
+  if (x.key != y.key || x.sub != y.sub) {
+    bool less = x.key < y.key || (x.key == y.key && x.sub < y.sub);
+    return _reverse ? !less : less;
+  }
+  return x.seq < y.seq;
+}
+
+/**
+ * @brief check if the entry at store index x is kept over the one at y
+ *
+ * Used as the heap order, which puts the entry to drop next on top
+ */
+bool topList::keeps(uint32_t x, uint32_t y) const {
+  return _last ? precedes(_rank[y], _rank[x]) : precedes(_rank[x], _rank[y]);
+}
+
+/**
+ * @brief consider an entry of a batch for the kept set
+ *
+ * @param batch the batch holding the entry
+ * @param pos the entry's position in the batch
+ * @param key the entry's sort key
+ * @param sub breaks ties in key
+ */
+void topList::offer(const fileList & batch, size_t pos, int64_t key, uint32_t sub) {
+  const rank r = {key, sub, _seq++};
+  if (_n == 0) {
+    return;
+  }
+  auto heapOrder = [this](uint32_t x, uint32_t y) { return keeps(x, y); };
+  if (_heap.size() == _n) {
+    const rank & worst = _rank[_heap.front()];
+    if (!(_last ? precedes(worst, r) : precedes(r, worst))) {
+      return;
+    }
+    std::pop_heap(_heap.begin(), _heap.end(), heapOrder);
+    _heap.pop_back();
+  }
+
+  uint32_t idx = _kept.copy(batch, pos);
+  _rank.push_back(r);
+  _heap.push_back(idx);
+  std::push_heap(_heap.begin(), _heap.end(), heapOrder);
+
+  if (_rank.size() > 2 * _heap.size() + compactSlack) {
+    compact();
+  }
+}
+
+/**
+ * @brief copy the kept entries into a fresh store, leaving the dropped ones
+ *
+ * The entries are copied in the order they were kept in, by their position
+ * in the list, and the heap is pointed at the copies
+ */
+void topList::compact() {
+  const uint32_t dropped = UINT32_MAX;
+  std::vector<uint32_t> moved(_rank.size(), dropped);
+  for (uint32_t idx : _heap) {
+    moved[idx] = 0;
+  }
+
+  fileList kept;
+  std::vector<rank> ranks;
+  ranks.reserve(_heap.size());
+  const std::vector<uint32_t> & order = _kept.order();
+  for (size_t pos = 0; pos < order.size(); ++pos) {
+    const uint32_t idx = order[pos];
+    if (moved[idx] != dropped) {
+      ranks.push_back(_rank[idx]);
+      moved[idx] = kept.copy(_kept, pos);
+    }
+  }
+  for (uint32_t & idx : _heap) {
+    idx = moved[idx];
+  }
+  _kept = kept;
+  _rank.swap(ranks);
+}
+
+/**
+ * @brief the kept entries in listing order
+ */
+fileList topList::take() {
+  std::sort(_heap.begin(), _heap.end(),
+            [this](uint32_t x, uint32_t y) { return precedes(_rank[x], _rank[y]); });
+  fileList kept = _kept;
+  kept.order() = _heap;
+  return kept;
+}
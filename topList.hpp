@@ -0,0 +1,52 @@
+#ifndef TOPLIST_HPP
+#define TOPLIST_HPP
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fileList.hpp"
+
+/**
+ * @brief keeps the first or last n entries of a sorted listing while the
+ *        entries go by unsorted
+ *
+ * The kept entries are copied out of each batch into a store of their own
+ * and sit in a heap with the one to drop next on top, so a listing of m
+ * entries takes O(m log n) time and O(n) memory. Entries are ranked on a
+ * numeric key, with ties kept in the order they were offered in, which is
+ * the order the full sort leaves them in.
+ */
+class topList {
+  public:
+    /**
+     * @brief where an entry falls in the listing, key first then sub
+     */
+    struct rank {
+      int64_t  key;
+      uint32_t sub;
+      uint64_t seq;     // order offered in, settles ties
+    };
+
+  private:
+    size_t                _n;
+    bool                  _last;     // keep the last n rather than the first
+    bool                  _reverse;  // the listing runs from high keys to low
+    fileList              _kept;     // kept entries, and dropped ones until compacted
+    std::vector<rank>     _rank;     // rank of each entry in _kept's store
+    std::vector<uint32_t> _heap;     // store indices of the kept entries
+    uint64_t              _seq;
+
+  private:
+    bool precedes(const rank & x, const rank & y) const;
+    bool keeps(uint32_t x, uint32_t y) const;
+    void compact();
+
+  public:
+    topList(size_t n, bool last, bool reverse);
+
+    void     offer(const fileList & batch, size_t pos, int64_t key, uint32_t sub);
+    fileList take();
+};
+
+#endif /* TOPLIST_HPP */
@@ -0,0 +1,197 @@
+#include "traversal.hpp"
+
+/**
+ * @brief start the read-ahead workers
+ *
+ * @param jobs number of worker threads
+ * @param read reads the listing of a directory
+ * @param descend picks the entries of a listing that will be listed next
+ * @param maxBytes limit on memory held by listings not yet taken
+ */
+traversal::traversal(unsigned jobs, const readFn & read, const descendFn & descend,
+                     size_t maxBytes) :
+  _read(read),
+  _descend(descend),
+  _maxBytes(maxBytes),
+  _deques(jobs),
+  _nQueued(0),
+  _buffered(0),
+  _next(0),
+  _stop(false)
+  {
+    for (unsigned i = 0; i < jobs; ++i) {
+      _threads.emplace_back(&traversal::worker, this, i);
+    }
+  }
+
+traversal::~traversal() {
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    _stop = true;
+  }
+  _workReady.notify_all();
+  for (std::thread & t : _threads) {
+    t.join();
+  }
+}
+
+/**
+ * @brief get a directory to read, from the back of our deque or the front of another
+ *
+ * @param id the worker's index
+ * @param dir set to the popped directory
+ *
+ * @return false if every deque was empty
+ */
+bool traversal::popDir(size_t id, std::shared_ptr<dirHandle> & dir) {
+  for (size_t k = 0; k < _deques.size(); ++k) {
+    workDeque & d = _deques[(id + k) % _deques.size()];
+    std::lock_guard<std::mutex> guard(d.lock);
+    if (d.dirs.empty()) {
+      continue;
+    }
+    if (k == 0) {
+      // Newest first, keeps our own reads in depth first order
+      dir = std::move(d.dirs.back());
+      d.dirs.pop_back();
+    } else {
+      // Steal the oldest, the shallowest directory the owner has queued
+      dir = std::move(d.dirs.front());
+      d.dirs.pop_front();
+    }
+    --_nQueued;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief queue the directories of a listing to be read ahead, _lock held
+ *
+ * Pushed last to first so the owner pops them in listing order
+ *
+ * @param id the deque to push onto
+ * @param files the listing to queue the directories of
+ */
+void traversal::queueChildren(size_t id, const fileList & files) {
+  workDeque & d = _deques[id];
+  std::lock_guard<std::mutex> guard(d.lock);
+  for (size_t i = files.size(); i-- > 0; ) {
+    const fileEnt f = files[i];
+    if (!_descend(f)) {
+      continue;
+    }
+    std::shared_ptr<dirHandle> dir = f.subdir();
+    taskKey key = keyOf(*dir);
+    if (_tasks.find(key) != _tasks.end()) {
+      continue;
+    }
+    task & t = _tasks[key];
+    t.state = taskState::queued;
+    t.dir = dir;
+    d.dirs.push_back(std::move(dir));
+    ++_nQueued;
+  }
+}
+
+/**
+ * @brief read queued directories while there is room in the read-ahead buffer
+ *
+ * @param id the worker's index
+ */
+void traversal::worker(size_t id) {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> guard(_lock);
+      _workReady.wait(guard, [&]{
+        return _stop || (_nQueued > 0 && _buffered < _maxBytes); });
+      if (_stop) {
+        return;
+      }
+    }
+
+    std::shared_ptr<dirHandle> dir;
+    if (!popDir(id, dir)) {
+      continue;
+    }
+
+    const taskKey key = keyOf(*dir);
+    {
+      // take() may have already claimed the directory
+      std::lock_guard<std::mutex> guard(_lock);
+      auto it = _tasks.find(key);
+      if (it == _tasks.end() || it->second.state != taskState::queued) {
+        continue;
+      }
+      it->second.state = taskState::running;
+    }
+
+    fileList files;
+    bool ok = _read(dir, files, true);
+
+    {
+      std::lock_guard<std::mutex> guard(_lock);
+      task & t = _tasks[key];
+      if (ok) {
+        queueChildren(id, files);
+        t.bytes = files.getStore()->bytes();
+        _buffered += t.bytes;
+        t.files = std::move(files);
+        t.state = taskState::done;
+      } else {
+        t.state = taskState::failed;
+      }
+    }
+    _taskDone.notify_all();
+    _workReady.notify_all();
+  }
+}
+
+/**
+ * @brief get the listing of a directory, reading it here if no worker has
+ *
+ * @param dir the directory to list
+ * @param filenames filled with the directory's entries
+ *
+ * @return false if the directory couldn't be read, the caller should report
+ */
+bool traversal::take(const std::shared_ptr<dirHandle> & dir, fileList & filenames) {
+  const taskKey key = keyOf(*dir);
+  std::unique_lock<std::mutex> guard(_lock);
+  auto it = _tasks.find(key);
+  if (it != _tasks.end() && it->second.state != taskState::queued) {
+    // Already being read ahead, wait for it rather than reading it twice
+    _taskDone.wait(guard, [&]{
+      auto t = _tasks.find(key);
+      return t == _tasks.end() || t->second.state != taskState::running; });
+
+    it = _tasks.find(key);
+    if (it != _tasks.end()) {
+      bool ok = it->second.state == taskState::done;
+      if (ok) {
+        filenames = std::move(it->second.files);
+        _buffered -= it->second.bytes;
+      }
+      _tasks.erase(it);
+      guard.unlock();
+      _workReady.notify_all();
+      return ok;
+    }
+  }
+
+  // Nobody has started on it yet, so read it here
+  if (it != _tasks.end()) {
+    it->second.state = taskState::running;
+  }
+  guard.unlock();
+  bool ok = _read(dir, filenames, false);
+  guard.lock();
+
+  _tasks.erase(key);
+  if (ok) {
+    queueChildren(_next++ % _deques.size(), filenames);
+  }
+  guard.unlock();
+  _workReady.notify_all();
+  return ok;
+}
@@ -0,0 +1,101 @@
+#ifndef TRAVERSAL_HPP
+#define TRAVERSAL_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+#include "fileEnt.hpp"
+#include "fileList.hpp"
+
+/**
+ * @brief reads and stats subdirectories on worker threads ahead of -R/--tree
+ *
+ * The printing side still walks the tree serially and asks for each listing
+ * with take(), so the output is exactly that of the serial walk. Workers
+ * keep their own deques of directories to read, popping the newest (depth
+ * first, the order they will be printed in) and stealing the oldest from
+ * each other when they run dry. Read-ahead stops while the listings waiting
+ * to be taken hold more than maxBytes of memory.
+ */
+class traversal {
+  public:
+    // Reads a directory, inWorker is false when called from take()
+    typedef std::function<bool(const std::shared_ptr<dirHandle> & dir,
+                               fileList & filenames,
+                               bool inWorker)> readFn;
+    // Decides which entries of a listing will be descended into
+    typedef std::function<bool(const fileEnt & f)> descendFn;
+
+    // Memory allowed to sit in read-ahead listings at once
+    static const size_t defaultReadAhead = 1 << 26;
+
+  private:
+    enum taskState : int {
+      queued  = 0,     // waiting in a deque
+      running = 1,     // being read by a worker or by take()
+      done    = 2,     // listing ready to be taken
+      failed  = 3      // read failed, take() leaves it to the caller
+    };
+
+    struct task {
+      taskState                  state;
+      std::shared_ptr<dirHandle> dir;    // keeps the parent in its key alive
+      fileList                   files;
+      size_t                     bytes;  // held by files' store
+    };
+
+    // Directories are identified by their parent's handle and their name in
+    // it, so no full paths are built to look them up
+    typedef std::pair<const dirHandle *, std::string> taskKey;
+    struct taskKeyHash {
+      size_t operator()(const taskKey & key) const {
+        return std::hash<const dirHandle *>()(key.first) ^ std::hash<std::string>()(key.second);
+      }
+    };
+
+    struct workDeque {
+      std::mutex                                     lock;
+      std::deque<std::shared_ptr<dirHandle> >        dirs;
+    };
+
+    readFn                    _read;
+    descendFn                 _descend;
+    size_t                    _maxBytes;
+
+    std::vector<std::thread>  _threads;
+    std::vector<workDeque>    _deques;
+    std::atomic<size_t>       _nQueued;    // directories sitting in the deques
+
+    std::mutex                _lock;       // guards everything below
+    std::condition_variable   _workReady;  // new work or buffer space
+    std::condition_variable   _taskDone;   // a task finished
+    std::unordered_map<taskKey, task, taskKeyHash> _tasks;
+    size_t                    _buffered;   // bytes held by done tasks
+    size_t                    _next;       // deque new children are pushed to
+    bool                      _stop;
+
+  private:
+    void worker(size_t id);
+    bool popDir(size_t id, std::shared_ptr<dirHandle> & dir);
+    void queueChildren(size_t id, const fileList & files);
+
+    static taskKey keyOf(const dirHandle & dir) {
+      return taskKey(dir.getParent().get(), dir.getName());
+    }
+
+  public:
+    traversal(unsigned jobs, const readFn & read, const descendFn & descend,
+              size_t maxBytes = defaultReadAhead);
+    ~traversal();
+
+    bool take(const std::shared_ptr<dirHandle> & dir, fileList & filenames);
+};
+
+#endif /* TRAVERSAL_HPP */
@@ -12,18 +12,21 @@ std::string usageMsg =
 //"                               '--block-size=M' prints sizes in units of        \n"
 //"                               1,048,576 bytes; see SIZE format below           \n"
 //"  -B, --ignore-backups       do not list implied entries ending with ~          \n"
-//"  -c                         with -lt: sort by, and show, ctime (time of last   \n"
-//"                               modification of file status information);        \n"
-//"                               with -l: show ctime and sort by name;            \n"
-//"                               otherwise: sort by ctime, newest first           \n"
+"  -c                         with -lt: sort by, and show, ctime (time of last   \n"
+"                               modification of file status information);        \n"
+"                               with -l: show ctime and sort by name             \n"
 //"  -C                         list entries by columns                            \n"
 "      --color[=WHEN]         colorize the output; WHEN can be 'never', 'auto',  \n"
 "                               or 'always' (the default); more info below       \n"
 //"  -d, --directory            list directories themselves, not their contents    \n"
+"      --dirbuf=SIZE          read directories SIZE bytes per getdents call;     \n"
+"                               accepts K, M and G suffixes (default 1M)         \n"
 //"  -D, --dired                generate output designed for Emacs' dired mode     \n"
 //"  -f                         do not sort, enable -aU, disable -ls --color       \n"
 //"  -F, --classify             append indicator (one of */=>@|) to entries        \n"
 //"      --file-type            likewise, except do not append '*'                 \n"
+"      --flat                 list every entry below the directory by its path,  \n"
+"                               as one sorted listing, cut by --head or --tail   \n"
 //"      --format=WORD          across -x, commas -m, horizontal -x, long -l,      \n"
 //"                               single-column -1, verbose -l, vertical -C        \n"
 //"      --full-time            like -l --time-style=full-iso                      \n"
@@ -41,6 +44,8 @@ std::string usageMsg =
 //"      --dereference-command-line-symlink-to-dir                                 \n"
 //"                             follow each command line symbolic link             \n"
 //"                               that points to a directory                       \n"
+"      --head=N               list only the first N entries of each directory,   \n"
+"                               with -t or -S without sorting the rest           \n"
 //"      --hide=PATTERN         do not list implied entries matching shell PATTERN \n"
 //"                               (overridden by -a or -A)                         \n"
 //"      --indicator-style=WORD  append indicator with style WORD to entry names:  \n"
@@ -48,13 +53,19 @@ std::string usageMsg =
 //"                               file-type (--file-type), classify (-F)           \n"
 //"  -i, --inode                print the index number of each file                \n"
 //"  -I, --ignore=PATTERN       do not list implied entries matching shell PATTERN \n"
+"      --id-cache[=SECS]      keep owner and group names in ~/.cache/lspp-ids    \n"
+"                               and reuse them for SECS seconds (default 3600)   \n"
+"      --jobs=N               stat and sort large directories with N threads,    \n"
+"                               and with -R or --tree read subdirectories ahead  \n"
 //"  -k, --kibibytes            default to 1024-byte blocks for disk usage         \n"
 "  -l                         use a long listing format                          \n"
 //"  -L, --dereference          when showing file information for a symbolic       \n"
 //"                               link, show information for the file the link     \n"
 //"                               references rather than for the link itself       \n"
+"      --mem-limit=SIZE       sort directories whose entries take more than SIZE \n"
+"                               bytes through temporary files                    \n"
 //"  -m                         fill width with a comma separated list of entries  \n"
-//"  -n, --numeric-uid-gid      like -l, but list numeric user and group IDs       \n"
+"  -n, --numeric-uid-gid      like -l, but list numeric user and group IDs       \n"
 //"  -N, --literal              print raw entry names (don't treat e.g. control    \n"
 //"                               characters specially)                            \n"
 "  -o                         like -l, but do not list group information         \n"
@@ -72,24 +83,25 @@ std::string usageMsg =
 "  -S                         sort by file size                                  \n"
 //"      --sort=WORD            sort by WORD instead of name: none (-U), size (-S),\n"
 //"                               time (-t), version (-v), extension (-X)          \n"
-//"      --time=WORD            with -l, show time as WORD instead of default      \n"
-//"                               modification time: atime or access or use (-u)   \n"
-//"                               ctime or status (-c); also use specified time    \n"
-//"                               as sort key if --sort=time                       \n"
-//"      --time-style=STYLE     with -l, show times using style STYLE:             \n"
-//"                               full-iso, long-iso, iso, locale, or +FORMAT;     \n"
-//"                               FORMAT is interpreted like in 'date'; if FORMAT  \n"
-//"                               is FORMAT1<newline>FORMAT2, then FORMAT1 applies \n"
-//"                               to non-recent files and FORMAT2 to recent files; \n"
-//"                               if STYLE is prefixed with 'posix-', STYLE        \n"
-//"                               takes effect only outside the POSIX locale       \n"
+"      --time=WORD            with -l, show time as WORD instead of default      \n"
+"                               modification time: atime or access or use (-u)   \n"
+"                               ctime or status (-c), birth or creation; also    \n"
+"                               use specified time as sort key with -t           \n"
+"      --time-style=STYLE     with -l, show times using style STYLE:             \n"
+"                               full-iso, long-iso, iso, locale, or +FORMAT;     \n"
+"                               FORMAT is interpreted like in 'date'; if FORMAT  \n"
+"                               is FORMAT1<newline>FORMAT2, then FORMAT1 applies \n"
+"                               to non-recent files and FORMAT2 to recent files; \n"
+"                               if STYLE is prefixed with 'posix-', STYLE        \n"
+"                               takes effect only outside the POSIX locale       \n"
 "  -t                         sort by modification time, newest first            \n"
+"      --tail=N               list only the last N entries of each directory     \n"
 //"  -T, --tabsize=COLS         assume tab stops at each COLS instead of 8         \n"
-//"  -u                         with -lt: sort by, and show, access time;          \n"
-//"                               with -l: show access time and sort by name;      \n"
-//"                               otherwise: sort by access time                   \n"
+"  -u                         with -lt: sort by, and show, access time;          \n"
+"                               with -l: show access time and sort by name       \n"
 "  -U                         do not sort; list entries in directory order       \n"
-//"  -v                         natural sort of (version) numbers within text      \n"
+"      --uring                stat through io_uring when the kernel supports it  \n"
+"  -v                         natural sort of (version) numbers within text      \n"
 //"  -w, --width=COLS           assume screen width instead of current value       \n"
 //"  -x                         list entries by lines instead of by columns        \n"
 "  -X                         sort alphabetically by entry extension             \n"
@@ -0,0 +1,105 @@
+#include <algorithm>
+
+#include "workerPool.hpp"
+
+/**
+ * @brief start the pool's threads
+ *
+ * @param jobs total number of threads to work with, including the caller
+ */
+workerPool::workerPool(unsigned jobs) :
+  _gen(0),
+  _busy(0),
+  _stop(false),
+  _fn(NULL),
+  _n(0),
+  _chunk(1),
+  _next(0)
+  {
+    for (unsigned i = 1; i < jobs; ++i) {
+      _threads.emplace_back(&workerPool::worker, this);
+    }
+  }
+
+workerPool::~workerPool() {
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    _stop = true;
+  }
+  _wake.notify_all();
+  for (std::thread & t : _threads) {
+    t.join();
+  }
+}
+
+/**
+ * @brief claim chunks of the current range until it is exhausted
+ */
+void workerPool::runChunks() {
+  for (;;) {
+    size_t begin = _next.fetch_add(_chunk);
+    if (begin >= _n) {
+      return;
+    }
+    (*_fn)(begin, std::min(begin + _chunk, _n));
+  }
+}
+
+/**
+ * @brief wait for ranges to be posted and help work through them
+ */
+void workerPool::worker() {
+  size_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> guard(_lock);
+      _wake.wait(guard, [&]{ return _stop || _gen != seen; });
+      if (_stop) {
+        return;
+      }
+      seen = _gen;
+    }
+
+    runChunks();
+
+    {
+      std::lock_guard<std::mutex> guard(_lock);
+      --_busy;
+    }
+    _done.notify_one();
+  }
+}
+
+/**
+ * @brief call fn on every chunk of [0, n) and wait for all of them to finish
+ *
+ * @param n size of the range
+ * @param chunk number of indices handed out at a time
+ * @param fn called with the [begin, end) bounds of each chunk
+ */
+void workerPool::parallelFor(size_t n, size_t chunk,
+                             const std::function<void(size_t, size_t)> & fn) {
+  if (_threads.empty() || n <= chunk) {
+    if (n > 0) {
+      fn(0, n);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    _fn    = &fn;
+    _n     = n;
+    _chunk = chunk;
+    _next  = 0;
+    _busy  = _threads.size();
+    ++_gen;
+  }
+  _wake.notify_all();
+
+  runChunks();
+
+  std::unique_lock<std::mutex> guard(_lock);
+  _done.wait(guard, [&]{ return _busy == 0; });
+  _fn = NULL;
+}
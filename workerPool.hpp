@@ -0,0 +1,46 @@
+#ifndef WORKERPOOL_HPP
+#define WORKERPOOL_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+/**
+ * @brief a fixed set of threads that split index ranges between them
+ *
+ * The calling thread works on the range as well, so a pool of N jobs only
+ * starts N - 1 threads. Only one range can be in flight at a time.
+ */
+class workerPool {
+  private:
+    std::vector<std::thread> _threads;
+    std::mutex               _lock;
+    std::condition_variable  _wake;     // signals a new range or shutdown
+    std::condition_variable  _done;     // signals a worker finished a range
+    size_t                   _gen;      // incremented for each new range
+    size_t                   _busy;     // workers still on the current range
+    bool                     _stop;
+
+    // The range currently being worked on
+    const std::function<void(size_t, size_t)> *_fn;
+    size_t                   _n;
+    size_t                   _chunk;
+    std::atomic<size_t>      _next;
+
+  private:
+    void worker();
+    void runChunks();
+
+  public:
+    workerPool(unsigned jobs);
+    ~workerPool();
+
+    void parallelFor(size_t n, size_t chunk, const std::function<void(size_t, size_t)> & fn);
+
+    size_t size() const { return _threads.size() + 1; }
+};
+
+#endif /* WORKERPOOL_HPP */